@@ -17,6 +17,7 @@
 #include <fstream>
 #include <sstream>
 #include <thread>
+#include <cmath>
 
 #include "Client.h"
 #include "Server.h"
@@ -24,6 +25,13 @@
 #include "CSketch.h"
 #include "CPong.h"
 #include "CAsteroidGame.h"
+#include "CSpriteCache.h"
+#include "CDrawList.h"
+#include "CEntityStore.h"
+#include "CSpatialGrid.h"
+#include "CParallel.h"
+#include "CAsteroid.h"
+#include "CPongBatch.h"
 // Must include Windows.h after Winsock2.h, so Serial must be included after Client/Server
 #include "Serial.h" 
 
@@ -422,6 +430,469 @@ void lab6()
     asteroid.run();
 }
 
+////////////////////////////////////////////////////////////////
+// Headless Lab 6 soak test under synthetic load
+////////////////////////////////////////////////////////////////
+void do_asteroid_stress()
+{
+    int asteroids = 0;
+    int bullets = 0;
+    int ticks = 0;
+    char draw = 0;
+
+    std::cout << "\nAsteroids to keep alive> ";
+    std::cin >> asteroids;
+    std::cout << "Bullets fired per tick> ";
+    std::cin >> bullets;
+    std::cout << "Ticks to run> ";
+    std::cin >> ticks;
+    std::cout << "Draw every tick (Y/N)> ";
+    std::cin >> draw;
+
+    CAsteroidGame asteroid(cv::Size(800, 600), 0, true);
+    asteroid.run_stress(std::max(asteroids, 0), std::max(bullets, 0), std::max(ticks, 1), draw == 'Y' || draw == 'y');
+}
+
+////////////////////////////////////////////////////////////////
+// Record or replay the inputs of a lab for repeatable benchmarks
+////////////////////////////////////////////////////////////////
+void do_input_log()
+{
+    int lab = 0;
+    char mode = 0;
+    std::string path;
+
+    std::cout << "\nLab (4, 5 or 6)> ";
+    std::cin >> lab;
+    std::cout << "(R)ecord or (P)lay> ";
+    std::cin >> mode;
+    std::cout << "Log file> ";
+    std::cin >> path;
+
+    if (mode == 'R' || mode == 'r')
+        CBase4618::set_input_log(CInputLog::RECORD, path);
+    else
+        CBase4618::set_input_log(CInputLog::REPLAY, path);
+
+    switch (lab)
+    {
+    case 4: lab4(); break;
+    case 5: lab5(); break;
+    case 6: lab6(); break;
+    }
+
+    CBase4618::set_input_log(CInputLog::OFF, "");
+}
+
+////////////////////////////////////////////////////////////////
+// Compare cv::circle with sprite stamping at asteroid-like scenes
+////////////////////////////////////////////////////////////////
+void do_sprite_bench()
+{
+    const int frames = 20;
+    const int counts[] = { 1000, 5000, 20000 };
+
+    cv::Mat canvas = cv::Mat::zeros(cv::Size(1200, 700), CV_8UC3);
+    CSpriteCache sprites;
+
+    for (int count : counts)
+    {
+        std::vector<cv::Point> pos(count);
+        std::vector<int> radius(count);
+
+        srand(4618);
+        for (int i = 0; i < count; i++)
+        {
+            pos[i] = cv::Point(rand() % canvas.cols, rand() % canvas.rows);
+            radius[i] = 20 + rand() % 40;   // asteroid radii 20 to 60
+        }
+
+        int64 start = cv::getTickCount();
+        for (int f = 0; f < frames; f++)
+        {
+            canvas.setTo(cv::Scalar(0, 0, 0));
+            for (int i = 0; i < count; i++)
+                cv::circle(canvas, pos[i], radius[i], cv::Scalar(0, 0, 200), 2);
+        }
+        double circle_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / frames;
+
+        start = cv::getTickCount();
+        for (int f = 0; f < frames; f++)
+        {
+            canvas.setTo(cv::Scalar(0, 0, 0));
+            for (int i = 0; i < count; i++)
+                sprites.stamp_circle(canvas, pos[i], radius[i], cv::Scalar(0, 0, 200), 2);
+        }
+        double stamp_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / frames;
+
+        std::cout << "\n" << count << " circles: cv::circle " << circle_ms
+            << " ms, sprite " << stamp_ms << " ms per frame";
+    }
+    std::cout << "\n" << sprites.size() << " sprite variants cached\n";
+}
+
+////////////////////////////////////////////////////////////////
+// Compare immediate drawing with the tiled draw list at 4K
+////////////////////////////////////////////////////////////////
+void do_drawlist_bench()
+{
+    const int frames = 10;
+    const int counts[] = { 10000, 50000 };
+
+    cv::Mat canvas = cv::Mat::zeros(cv::Size(3840, 2160), CV_8UC3);
+    CDrawList list;
+
+    std::cout << "\n" << cv::getNumThreads() << " threads";
+
+    for (int count : counts)
+    {
+        std::vector<cv::Point> pos(count);
+        std::vector<int> radius(count);
+
+        srand(4618);
+        for (int i = 0; i < count; i++)
+        {
+            pos[i] = cv::Point(rand() % canvas.cols, rand() % canvas.rows);
+            radius[i] = (i % 4 == 0) ? 20 + rand() % 40 : 4;   // asteroids and bullets
+        }
+
+        int64 start = cv::getTickCount();
+        for (int f = 0; f < frames; f++)
+        {
+            canvas.setTo(cv::Scalar(0, 0, 0));
+            for (int i = 0; i < count; i++)
+            {
+                cv::circle(canvas, pos[i], radius[i], cv::Scalar(0, 0, 200), 2);
+                if (i % 16 == 0)
+                    cv::line(canvas, pos[i], pos[i] + cv::Point(20, 0), cv::Scalar(255, 255, 255), 2);
+            }
+        }
+        double immediate_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / frames;
+
+        start = cv::getTickCount();
+        for (int f = 0; f < frames; f++)
+        {
+            canvas.setTo(cv::Scalar(0, 0, 0));
+            list.clear();
+            for (int i = 0; i < count; i++)
+            {
+                list.circle(pos[i], radius[i], cv::Scalar(0, 0, 200), 2);
+                if (i % 16 == 0)
+                    list.line(pos[i], pos[i] + cv::Point(20, 0), cv::Scalar(255, 255, 255), 2);
+            }
+            list.render(canvas);
+        }
+        double list_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / frames;
+
+        std::cout << "\n" << list.size() << " primitives: immediate " << immediate_ms
+            << " ms, draw list " << list_ms << " ms per frame";
+    }
+    std::cout << "\n";
+}
+
+////////////////////////////////////////////////////////////////
+// Compare per-object and structure-of-arrays asteroid updates
+////////////////////////////////////////////////////////////////
+void do_entity_bench()
+{
+    const int frames = 100;
+    const int count = 100000;
+    const float dt = 1.0f / 60.0f;
+    const cv::Size board(1200, 700);
+
+    std::vector<CAsteroid> objects;
+    CEntityStore store(count);
+
+    srand(4618);
+    for (int i = 0; i < count; i++)
+    {
+        cv::Point2f pos((float)(rand() % board.width), (float)(rand() % board.height));
+        cv::Point2f vel((float)(rand() % 400 - 200), (float)(rand() % 400 - 200));
+        int radius = 20 + rand() % 40;
+
+        objects.push_back(CAsteroid(pos, vel, radius));
+        store.add(pos, vel, (float)radius);
+    }
+
+    // Same work as the game's former move + wrap_object loop
+    int64 start = cv::getTickCount();
+    for (int f = 0; f < frames; f++)
+    {
+        update_all(objects, dt);
+
+        for (auto& a : objects)
+        {
+            cv::Point2f pos = a.get_pos();
+            if (pos.x < 0) pos.x = (float)board.width;
+            else if (pos.x > board.width) pos.x = 0;
+            if (pos.y < 0) pos.y = (float)board.height;
+            else if (pos.y > board.height) pos.y = 0;
+            a.set_pos(pos);
+        }
+    }
+    double object_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / frames;
+
+    start = cv::getTickCount();
+    for (int f = 0; f < frames; f++)
+    {
+        store.move(dt);
+        store.wrap(board);
+    }
+    double store_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / frames;
+
+    std::cout << "\n" << count << " asteroids move + wrap: objects " << object_ms
+        << " ms, entity store " << store_ms << " ms per frame\n";
+}
+
+////////////////////////////////////////////////////////////////
+// Compare all-pairs and grid broadphase collision tests
+////////////////////////////////////////////////////////////////
+void do_collision_bench()
+{
+    const int frames = 10;
+    const int counts[] = { 1000, 10000, 100000 };
+    const int brute_limit = 10000;   // all pairs is too slow to time beyond this
+
+    for (int count : counts)
+    {
+        // The board grows with the count so the density matches the game
+        int side = (int)(std::sqrt((double)count) * 60.0);
+        cv::Size board(side, side);
+
+        CEntityStore asteroids(count);
+        CEntityStore bullets(count / 4);
+        CSpatialGrid grid;
+
+        srand(4618);
+        for (int i = 0; i < count; i++)
+        {
+            cv::Point2f pos((float)(rand() % side), (float)(rand() % side));
+            if (i % 5 == 0)
+                bullets.add(pos, cv::Point2f(0, 0), 4.0f);
+            else
+                asteroids.add(pos, cv::Point2f(0, 0), (float)(20 + rand() % 40));
+        }
+
+        int brute_hits = 0;
+        double brute_ms = -1.0;
+        if (count <= brute_limit)
+        {
+            int64 start = cv::getTickCount();
+            for (int f = 0; f < frames; f++)
+            {
+                brute_hits = 0;
+                for (size_t b = 0; b < bullets.size(); b++)
+                    for (size_t a = 0; a < asteroids.size(); a++)
+                        brute_hits += asteroids.collide(a, bullets.get_pos(b), bullets.get_radius(b));
+            }
+            brute_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / frames;
+        }
+
+        int grid_hits = 0;
+        int64 start = cv::getTickCount();
+        for (int f = 0; f < frames; f++)
+        {
+            grid_hits = 0;
+            grid.build(asteroids, board);
+            for (size_t b = 0; b < bullets.size(); b++)
+            {
+                cv::Point2f pos = bullets.get_pos(b);
+                float radius = bullets.get_radius(b);
+                grid.query(pos, radius, [&](size_t a) { grid_hits += asteroids.collide(a, pos, radius); });
+            }
+        }
+        double grid_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / frames;
+
+        std::cout << "\n" << count << " objects: ";
+        if (brute_ms >= 0.0)
+            std::cout << "all pairs " << brute_ms << " ms (" << brute_hits << " hits), ";
+        std::cout << "grid " << grid_ms << " ms (" << grid_hits << " hits) per frame";
+    }
+    std::cout << "\n";
+}
+
+////////////////////////////////////////////////////////////////
+// Scale the chunked asteroid update and collision pass over cores
+////////////////////////////////////////////////////////////////
+void do_parallel_bench()
+{
+    const int frames = 20;
+    const int count = 500000;
+    const int bullet_count = count / 10;
+    const float dt = 1.0f / 60.0f;
+
+    int side = (int)(std::sqrt((double)count) * 60.0);
+    cv::Size board(side, side);
+    int cpus = cv::getNumberOfCPUs();
+    int saved_threads = cv::getNumThreads();
+
+    std::vector<int> thread_counts;
+    for (int t = 1; t < cpus; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(cpus);
+
+    std::vector<std::vector<std::pair<int, int>>> events;
+    double base_ms = 0.0;
+
+    for (int threads : thread_counts)
+    {
+        cv::setNumThreads(threads);
+
+        CEntityStore asteroids(count);
+        CEntityStore bullets(bullet_count);
+        CSpatialGrid grid;
+
+        srand(4618);
+        for (int i = 0; i < count; i++)
+        {
+            cv::Point2f pos((float)(rand() % side), (float)(rand() % side));
+            cv::Point2f vel((float)(rand() % 400 - 200), (float)(rand() % 400 - 200));
+            asteroids.add(pos, vel, (float)(20 + rand() % 40), 1000000);
+        }
+        for (int i = 0; i < bullet_count; i++)
+            bullets.add(cv::Point2f((float)(rand() % side), (float)(rand() % side)), cv::Point2f(0, 0), 4.0f, 1000000);
+
+        long long hits = 0;
+        int64 start = cv::getTickCount();
+        for (int f = 0; f < frames; f++)
+        {
+            // Per-chunk generators give every thread count the same random drift
+            parallel_chunks_seeded((int)asteroids.size(), 4618 + f, [&](int, cv::Range r, cv::RNG& rng)
+            {
+                for (int i = r.start; i < r.end; i++)
+                    asteroids.set_vel(i, asteroids.get_vel(i) + cv::Point2f(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f)));
+                asteroids.move(dt, r);
+                asteroids.wrap(board, r);
+            });
+
+            grid.build(asteroids, board);
+
+            int chunks = chunk_count((int)bullets.size());
+            if ((int)events.size() < chunks)
+                events.resize(chunks);
+
+            parallel_chunks((int)bullets.size(), [&](int c, cv::Range r)
+            {
+                events[c].clear();
+                for (int b = r.start; b < r.end; b++)
+                {
+                    cv::Point2f pos = bullets.get_pos(b);
+                    grid.query(pos, 4.0f, [&](size_t a)
+                    {
+                        if (asteroids.collide(a, pos, 4.0f))
+                            events[c].push_back(std::make_pair(b, (int)a));
+                    });
+                }
+            });
+
+            // Ordered merge, as CAsteroidGame::handle_collisions does
+            for (int c = 0; c < chunks; c++)
+            {
+                for (const std::pair<int, int>& e : events[c])
+                {
+                    bullets.hit(e.first);
+                    asteroids.hit(e.second);
+                    hits++;
+                }
+            }
+        }
+        double ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / frames;
+        if (threads == 1)
+            base_ms = ms;
+
+        // Identical for every thread count if the update is deterministic
+        double checksum = 0.0;
+        for (size_t i = 0; i < asteroids.size(); i++)
+            checksum += asteroids.get_pos(i).x + asteroids.get_pos(i).y;
+
+        std::cout << "\n" << threads << " threads: " << ms << " ms per frame, speedup "
+            << base_ms / ms << ", " << hits << " hits, checksum " << checksum;
+    }
+
+    cv::setNumThreads(saved_threads);
+    std::cout << "\n";
+}
+
+////////////////////////////////////////////////////////////////
+// Step many headless Pong matches over cores
+////////////////////////////////////////////////////////////////
+void do_pong_batch_bench()
+{
+    const int matches = 65536;
+    const int steps = 2000;
+    const float dt = 1.0f / 40.0f;
+
+    int cpus = cv::getNumberOfCPUs();
+    int saved_threads = cv::getNumThreads();
+
+    std::vector<int> thread_counts;
+    for (int t = 1; t < cpus; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(cpus);
+
+    for (int threads : thread_counts)
+    {
+        cv::setNumThreads(threads);
+
+        // Right paddle speeds spread over the batch, as a tuning sweep would
+        CPongBatch batch(matches);
+        for (int i = 0; i < matches; i++)
+            batch.set_paddle_speed(i, 10.0f + 30.0f * i / matches);
+
+        int64 start = cv::getTickCount();
+        for (int s = 0; s < steps; s++)
+        {
+            parallel_chunks(matches, [&](int, cv::Range r)
+            {
+                batch.step(dt, r);
+            });
+        }
+        double sec = (cv::getTickCount() - start) / cv::getTickFrequency();
+        double rate = (double)matches * steps / sec;
+
+        // Identical for every thread count; each match has its own generator
+        long long wins_left = 0;
+        long long wins_right = 0;
+        for (int i = 0; i < matches; i++)
+        {
+            wins_left += batch.get_wins_left(i);
+            wins_right += batch.get_wins_right(i);
+        }
+
+        std::cout << "\n" << threads << " threads: " << rate / 1e6 << " M game-steps/s, "
+            << rate / threads / 1e6 << " M per core, matches won " << wins_left << " : " << wins_right;
+    }
+
+    cv::setNumThreads(saved_threads);
+    std::cout << "\n";
+}
+
+////////////////////////////////////////////////////////////////
+// Select GDI DIB section presentation for the labs
+////////////////////////////////////////////////////////////////
+void do_select_presenter()
+{
+    char choice = 0;
+
+    std::cout << "\nPresent with (H)ighGUI or (G)DI DIB section> ";
+    std::cin >> choice;
+
+    CBase4618::set_gdi_present(choice == 'G' || choice == 'g');
+}
+
+////////////////////////////////////////////////////////////////
+// Select the 8-bit palette-indexed world for the games
+////////////////////////////////////////////////////////////////
+void do_select_world_format()
+{
+    char choice = 0;
+
+    std::cout << "\nDraw the world in (B)GR or (I)ndexed 8-bit> ";
+    std::cin >> choice;
+
+    CBase4618::set_indexed_mode(choice == 'I' || choice == 'i');
+}
+
 void print_menu()
 {
   std::cout << "\n***********************************";
@@ -440,6 +911,16 @@ void print_menu()
   std::cout << "\n(11) Show image manipulation";
   std::cout << "\n(12) Show video manipulation";
   std::cout << "\n(13) Test client/server communication";
+  std::cout << "\n(14) Record/replay lab input";
+  std::cout << "\n(15) Sprite draw benchmark";
+  std::cout << "\n(16) Draw list benchmark";
+  std::cout << "\n(17) Select presentation backend";
+  std::cout << "\n(18) Select world pixel format";
+  std::cout << "\n(19) Entity update benchmark";
+  std::cout << "\n(20) Collision broadphase benchmark";
+  std::cout << "\n(21) Parallel entity update benchmark";
+  std::cout << "\n(22) Asteroids stress test (headless)";
+  std::cout << "\n(23) Batched Pong simulation benchmark";
   std::cout << "\n(0) Exit";
   std::cout << "\nCMD> ";
 }
@@ -465,6 +946,16 @@ int main(int argc, char* argv[])
 		case 11: do_image(); break;
 		case 12: do_video(); break;
     case 13: do_clientserver(); break;
+    case 14: do_input_log(); break;
+    case 15: do_sprite_bench(); break;
+    case 16: do_drawlist_bench(); break;
+    case 17: do_select_presenter(); break;
+    case 18: do_select_world_format(); break;
+    case 19: do_entity_bench(); break;
+    case 20: do_collision_bench(); break;
+    case 21: do_parallel_bench(); break;
+    case 22: do_asteroid_stress(); break;
+    case 23: do_pong_batch_bench(); break;
 		}
 	} while (cmd != 0);
 }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @file CAlignedAllocator.h
+ * @brief std::vector allocator returning SIMD-aligned storage.
+ */
+
+ /**
+  * @class CAlignedAllocator
+  * @brief Allocates through cv::fastMalloc, which aligns to CV_MALLOC_ALIGN.
+  *
+  * std::allocator only guarantees alignment for the element type, so the
+  * start of a float array may sit anywhere in a cache line and vector loads
+  * over it need an unaligned prologue. With this allocator every array
+  * starts on a CV_MALLOC_ALIGN boundary (at least 16 bytes), the same
+  * alignment cv::Mat data has.
+  *
+  * @tparam T Element type.
+  */
+template <typename T>
+class CAlignedAllocator
+{
+public:
+    typedef T value_type;
+
+    CAlignedAllocator() {}
+
+    template <typename U>
+    CAlignedAllocator(const CAlignedAllocator<U>&) {}
+
+    /// @brief Allocates storage for n elements; cv::fastMalloc raises cv::Exception when out of memory.
+    T* allocate(size_t n) { return (T*)cv::fastMalloc(n * sizeof(T)); }
+
+    /// @brief Releases storage from allocate().
+    void deallocate(T* p, size_t) { cv::fastFree(p); }
+};
+
+template <typename T, typename U>
+bool operator==(const CAlignedAllocator<T>&, const CAlignedAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const CAlignedAllocator<T>&, const CAlignedAllocator<U>&) { return false; }
+
+/// @brief std::vector whose storage starts on a CV_MALLOC_ALIGN boundary.
+template <typename T>
+using CAlignedVector = std::vector<T, CAlignedAllocator<T>>;
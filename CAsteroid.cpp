@@ -16,5 +16,10 @@ void CAsteroid::move(double dt)
 
 void CAsteroid::draw(Mat& im)
 {
-    circle(im, _position, _radius, Scalar(0, 0, 200), 2);
+    _sprites.stamp_circle(im, _position, _radius, Scalar(0, 0, 200), 2);
+}
+
+void CAsteroid::draw(CDrawList& list, const Scalar& color)
+{
+    list.circle(_position, _radius, color, 2);
 }
\ No newline at end of file
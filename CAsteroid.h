@@ -1,15 +1,15 @@
 #pragma once
-#include "CGameObject.h"
+#include "CEntity.h"
 
 /**
  * @class CAsteroid
  * @brief Represents a moving asteroid in the game.
  *
- * CAsteroid inherits from CGameObject.
+ * CAsteroid inherits from CGameObject through CEntity.
  * Asteroids move with constant velocity and wrap
  * around the screen boundaries.
  */
-class CAsteroid : public CGameObject
+class CAsteroid : public CEntity<CAsteroid>
 {
 public:
 
@@ -35,4 +35,12 @@ public:
      * @param im OpenCV image to draw on.
      */
     void draw(Mat& im);
+
+    /**
+     * @brief Submit asteroid graphics to a frame draw list.
+     *
+     * @param list Draw list for the current frame.
+     * @param color Outline colour, or a palette index for an indexed world.
+     */
+    void draw(CDrawList& list, const Scalar& color = Scalar(0, 0, 200));
 };
\ No newline at end of file
@@ -1,26 +1,93 @@
 #include "stdafx.h"
 #include "CAsteroidGame.h"
 #include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
 #include "cvui.h"
 
+#ifdef _WIN32
+#include <psapi.h>   // windows.h comes in through CControl
+#pragma comment(lib, "psapi.lib")
+#elif defined(__linux__)
+#include <sys/resource.h>
+#endif
+
 #define JOYSTICK_Y 26
 #define JOYSTICK_X 2
 #define JOY_DEADZONE 5.0
 #define BUTTON_S1 33
 #define BUTTON_S2  32
 #define BULLET_COOLDOWN 0.025
-CAsteroidGame::CAsteroidGame(cv::Size size, int comport)
+#define BULLET_SPEED 600.0f
+#define BULLET_RADIUS 4
+#define PEN_BLACK 0     // palette indices used by the world
+#define PEN_WHITE 1
+#define PEN_ASTEROID 2
+#define SIM_DT (1.0 / 60.0)          // fixed simulation step; one stress tick is one step
+#define WORLD_SCREENS 4              // world size in screens, across and down
+#define LOD_STEPS 4                  // background asteroids are advanced every this many steps
+#define LOD_MARGIN 200.0f            // band around the view that is simulated every step
+#define CULL_SLACK 8.0f              // covers interpolation since the grid was built
+#define STRESS_REPORT_TICKS 1000     // ticks between stress reports
+#define STRESS_PHASES 8
+
+// Peak resident memory of the process in MB, or -1 if unknown
+static double peak_memory_mb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+#elif defined(__linux__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return usage.ru_maxrss / 1024.0;   // reported in KB
+#endif
+    return -1.0;
+}
+CAsteroidGame::CAsteroidGame(cv::Size size, int comport, bool headless)
 {
-    _control.init_com(comport);
+    _headless = headless;
+    _window_name = "Lab 6 Asteroid";
+
+    if (!_headless)
+    {
+        _control.init_com(comport);
 
-    cv::namedWindow(_window_name);
-    //CVUI
-    cvui::init(_window_name);
+        cv::namedWindow(_window_name);
+        //CVUI
+        cvui::init(_window_name);
+    }
     //canvas
-    _canvas = cv::Mat::zeros(size, CV_8UC3);
+    create_canvas(size);
+
+    // The screen is a camera onto a larger world
+    _world_size = cv::Size(size.width * WORLD_SCREENS, size.height * WORLD_SCREENS);
+    _camera = cv::Point2f(0.0f, 0.0f);
+    _lod_phase = 0;
 
     //timing
-    _last_time = (double)cv::getTickCount() / cv::getTickFrequency();
+    _dt = 0.0;
+    set_fixed_timestep(SIM_DT);
+    set_idle_policy(true); // idle while disconnected or game over
+
+    // Scene goes to _world so 'r' can render it at a reduced resolution
+    _world_target = true;
+
+    // Three colours; the scene also runs with the 8-bit indexed world
+    set_palette(PEN_BLACK, cv::Scalar(0, 0, 0));
+    set_palette(PEN_WHITE, cv::Scalar(255, 255, 255));
+    set_palette(PEN_ASTEROID, cv::Scalar(0, 0, 200));
+    _indexed_supported = true;
+
+    // Fixed banners are stroked once and composited from the layer cache
+    _layer_disconnected = _layers.add_layer();
+    _layer_game_over = _layers.add_layer();
+
+    _latch_channels.push_back(JOYSTICK_X);
+    _latch_channels.push_back(JOYSTICK_Y);
 
     reset_game();
 }
@@ -56,33 +123,60 @@ void CAsteroidGame::update()
         return;
     }
 
+    _frame_changed = true; // game in progress
+
+    // Ship thrust is the latency-critical use of the joystick
+    latch_analog(JOYSTICK_X, _joy_x);
+    latch_analog(JOYSTICK_Y, _joy_y);
+
+    // Whole fixed steps for the time banked so far; draw() blends the last two
+    int steps = fixed_steps();
+    for (int i = 0; i < steps && !_game_over; i++)
+        step();
+
+    handle_game_reset(); //resets the game
+}
+
+void CAsteroidGame::step()
+{
+    _ship_prev = _ship.get_pos();
+
     process_joystick(); // ship accel
     update_ship(); // movement + clamping
-    
+
     handle_fire_request(); //makes bullet
-    
+
     update_bullets(); // movement of bullet
     update_asteroids();
 
-    handle_collisions();
-    remove_dead_bullets(); //erase when exit screen
+    // Asteroids destroyed last step go just before the grid is rebuilt, so the
+    // grid's indices stay valid for drawing and for the next step's near set
     remove_dead_asteroids();
-
-    handle_game_reset(); //resets the game
+    handle_collisions();
+    remove_dead_bullets(); // deferred destruction: spent or off the world
 }
 
 void CAsteroidGame::draw()
 {
-    _canvas.setTo(Scalar(0, 0, 0));
+    _world.setTo(pen(PEN_BLACK));
+    _draw_list.clear();
+
+    // The camera follows the ship as drawn, not as last simulated
+    _camera = camera_for(ship_draw_pos());
 
+    // Objects are submitted here and rasterized in parallel tiles below
     draw_ship();
     draw_bullets();
     draw_asteroids();
+    _draw_list.render(_world, _world_scale);
+}
+
+void CAsteroidGame::draw_overlay()
+{
     draw_points();
 
     handle_micro_not_connected();
     draw_game_over();
-    cv::imshow(_window_name, _canvas);
 }
 
 ////////////////////////////////////
@@ -90,9 +184,8 @@ void CAsteroidGame::draw()
 ///////////////////////////////////
 void CAsteroidGame::update_timing()
 {
-    double now = (double)cv::getTickCount() / cv::getTickFrequency();
-    _dt = now - _last_time;
-    _last_time = now;
+    // Every step is the same length; fixed_steps() banks the measured frame time
+    _dt = _sim_dt;
 }
 
 void CAsteroidGame::process_joystick()
@@ -102,17 +195,24 @@ void CAsteroidGame::process_joystick()
 
     cv::Point2f accel(0, 0);
 
+    // The ship reacts to these samples this frame
     if (abs(centered_x) > JOY_DEADZONE)
+    {
         accel.x = centered_x;
+        tag_frame(_control.get_input_tag(ANALOG, JOYSTICK_X));
+    }
 
     if (abs(centered_y) > JOY_DEADZONE)
+    {
         accel.y = centered_y;
+        tag_frame(_control.get_input_tag(ANALOG, JOYSTICK_Y));
+    }
 
     _ship.thrust(accel * _accel_scale, _dt);
 }
 void CAsteroidGame::update_ship()
 {
-    _ship.move(_dt);
+    _ship.update(_dt);
     clamp_object(_ship);
 }
 void CAsteroidGame::clamp_object(CGameObject& obj)
@@ -125,80 +225,87 @@ void CAsteroidGame::clamp_object(CGameObject& obj)
         pos.x = r;
 
     // Right wall
-    if (pos.x + r > _canvas.cols)
-        pos.x = _canvas.cols - r;
+    if (pos.x + r > _world_size.width)
+        pos.x = _world_size.width - r;
 
     // Top wall
     if (pos.y - r < 0)
         pos.y = r;
 
     // Bottom wall
-    if (pos.y + r > _canvas.rows)
-        pos.y = _canvas.rows - r;
+    if (pos.y + r > _world_size.height)
+        pos.y = _world_size.height - r;
 
     obj.set_pos(pos);
 }
+cv::Point2f CAsteroidGame::ship_draw_pos()
+{
+    float alpha = (float)_sim_alpha;
+    return _ship_prev + (_ship.get_pos() - _ship_prev) * alpha;
+}
+cv::Point2f CAsteroidGame::camera_for(cv::Point2f focus) const
+{
+    float x = focus.x - _canvas.cols / 2.0f;
+    float y = focus.y - _canvas.rows / 2.0f;
+
+    // Stops at the world edges rather than showing past them
+    x = std::min(std::max(x, 0.0f), (float)(_world_size.width - _canvas.cols));
+    y = std::min(std::max(y, 0.0f), (float)(_world_size.height - _canvas.rows));
+    return cv::Point2f(x, y);
+}
+cv::Rect2f CAsteroidGame::near_rect()
+{
+    cv::Point2f origin = camera_for(_ship.get_pos());
+    return cv::Rect2f(origin.x - LOD_MARGIN, origin.y - LOD_MARGIN,
+        _canvas.cols + 2.0f * LOD_MARGIN, _canvas.rows + 2.0f * LOD_MARGIN);
+}
 void CAsteroidGame::draw_ship()
 {
-    _ship.draw(_canvas);
-    std::string lives_text = "Lives: " + std::to_string(_ship.get_lives());
-
-    cv::putText(
-        _canvas,
-        lives_text,
-        cv::Point(20, 60),
-        cv::FONT_HERSHEY_SIMPLEX,
-        0.8,
-        cv::Scalar(255, 255, 255),
-        2
-    );
+    // Drawn from a copy placed between the last two steps, in screen coordinates
+    CShip ship = _ship;
+    ship.set_pos(ship_draw_pos() - _camera);
+    ship.submit(_draw_list, pen(PEN_WHITE));
 }
 
 void CAsteroidGame::update_bullets() {
-    for (auto& b : _bullets)
-        b.move(_dt);
+    float dt = (float)_dt;
+    parallel_chunks((int)_bullets.size(), [&](int, cv::Range r)
+    {
+        _bullets.save_previous(r);
+        _bullets.move(dt, r);
+    });
 }
 void CAsteroidGame::remove_dead_bullets()
 {
-    _bullets.erase(
-        std::remove_if(_bullets.begin(), _bullets.end(),
-            [&](CBullet& b)
-            {
-                return b.is_off_screen(_canvas.size());
-            }),
-        _bullets.end());
+    // Hit bullets were marked in handle_collisions(); both go in one pass
+    _bullets.mark_off_screen(_world_size);
+    _bullets.flush();
 }
 void CAsteroidGame::handle_fire_request()
 {
     if (_fire_requested)
     {
-        _bullets.push_back(
-            CBullet(_ship.get_pos(), _ship.get_angle())
-        );
+        fire(_ship.get_angle());
+        tag_frame(_control.get_input_tag(DIGITAL, BUTTON_S2));
 
         _fire_requested = false;
     }
 }
+void CAsteroidGame::fire(float angle)
+{
+    _bullets.add(_ship.get_pos(),
+        cv::Point2f(BULLET_SPEED * cos(angle), BULLET_SPEED * sin(angle)),
+        BULLET_RADIUS);
+}
 void CAsteroidGame::draw_bullets() 
 {    
-    for (auto& b : _bullets)
-        b.draw(_canvas);
-
-    std::string text = "Bullets: " + std::to_string(_bullets.size());
-
-    cv::putText(
-        _canvas,
-        text,
-        cv::Point(20, 30),              // position
-        cv::FONT_HERSHEY_SIMPLEX,
-        0.8,                            // scale
-        cv::Scalar(255, 255, 255),
-        2
-    );
+    _bullets.draw(_draw_list, pen(PEN_WHITE), 1, (float)_sim_alpha, -_camera);
 }
 
 void CAsteroidGame::update_asteroids()
 {
+    _asteroids.tick();
+
     _asteroid_spawn_timer += _dt;
 
     if (_asteroid_spawn_timer >= _asteroid_spawn_interval)
@@ -207,26 +314,53 @@ void CAsteroidGame::update_asteroids()
         _asteroid_spawn_timer = 0.0;
     }
 
-    for (auto& a : _asteroids)
+    float dt = (float)_dt;
+    cv::Size world = _world_size;
+
+    // Near the view and near every bullet, every step. The grid is from the
+    // previous step; nothing has been flushed or moved since, so its indices
+    // and filed positions are still valid, and a background asteroid is at
+    // most this far from where it really is now.
+    float behind = _asteroids.max_behind(dt);
+
+    _near_asteroids.clear();
+    auto collect = [&](size_t a)
     {
-        a.move(_dt);
-        wrap_object(a);
-    }
+        _near_asteroids.push_back((int)a);
+    };
+    _asteroid_grid.query_rect(near_rect(), collect);
+
+    // Bullets fly across the whole world, so asteroids they may hit are caught
+    // up before the grid is rebuilt and the collision tests see where they are.
+    // One that crossed the world edge while behind is only found from the side
+    // it left.
+    for (size_t b = 0; b < _bullets.size(); b++)
+        _asteroid_grid.query(_bullets.get_pos(b), _bullets.get_radius(b) + behind, collect);
+
+    _asteroids.catch_up(dt, world, _near_asteroids);
+
+    // Everywhere else, one slice of the store per step: each asteroid is
+    // caught up every LOD_STEPS steps, in parallel chunks of the slice
+    int n = (int)_asteroids.size();
+    int begin = n * _lod_phase / LOD_STEPS;
+    int end = n * (_lod_phase + 1) / LOD_STEPS;
+    _lod_phase = (_lod_phase + 1) % LOD_STEPS;
+
+    parallel_chunks(end - begin, [&](int, cv::Range r)
+    {
+        _asteroids.catch_up(dt, world, cv::Range(begin + r.start, begin + r.end));
+    });
 }
 void CAsteroidGame::spawn_asteroid()
 {
     // Random size
     int radius = 20 + rand() % 40;   // 20 to 60
 
-    // Random position (spawn at edge)
-    int edge = rand() % 4;
+    // Random position in the world, but never where it would pop into view
+    cv::Point2f pos((float)(rand() % _world_size.width), (float)(rand() % _world_size.height));
 
-    cv::Point2f pos;
-
-    if (edge == 0)      pos = cv::Point2f(0, rand() % _canvas.rows);                // left
-    else if (edge == 1) pos = cv::Point2f(_canvas.cols, rand() % _canvas.rows);     // right
-    else if (edge == 2) pos = cv::Point2f(rand() % _canvas.cols, 0);                // top
-    else                pos = cv::Point2f(rand() % _canvas.cols, _canvas.rows);     // bottom
+    if (near_rect().contains(pos))
+        pos.x = std::fmod(pos.x + _world_size.width / 2.0f, (float)_world_size.width);
 
     // Random direction
     float angle = (rand() % 360) * 3.14f / 180.0f;
@@ -238,117 +372,138 @@ void CAsteroidGame::spawn_asteroid()
         speed * sin(angle)
     );
 
-    _asteroids.push_back(CAsteroid(pos, vel, radius));
-}
-void CAsteroidGame::wrap_object(CGameObject& obj)
-{
-    cv::Point2f pos = obj.get_pos();
-
-    if (pos.x < 0)
-        pos.x = _canvas.cols;
-    else if (pos.x > _canvas.cols)
-        pos.x = 0;
-
-    if (pos.y < 0)
-        pos.y = _canvas.rows;
-    else if (pos.y > _canvas.rows)
-        pos.y = 0;
-
-    obj.set_pos(pos);
+    _asteroids.add(pos, vel, (float)radius);
 }
 void CAsteroidGame::draw_asteroids()
 {
-    for (auto& a : _asteroids)
-        a.draw(_canvas);
+    // Only asteroids in grid cells around the view are submitted
+    cv::Rect2f view(_camera.x - CULL_SLACK, _camera.y - CULL_SLACK,
+        _canvas.cols + 2.0f * CULL_SLACK, _canvas.rows + 2.0f * CULL_SLACK);
+
+    _visible_asteroids.clear();
+    _asteroid_grid.query_rect(view, [&](size_t a)
+    {
+        _visible_asteroids.push_back((int)a);
+    });
+    _asteroids.draw(_draw_list, _visible_asteroids, pen(PEN_ASTEROID), 2, (float)_sim_alpha, -_camera);
 }
 
 void CAsteroidGame::handle_collisions()
 {
-    // Bullet vs Asteroid
-    for (auto& b : _bullets)
+    // Bullet vs Asteroid; only asteroids in cells near each bullet are tested
+    _asteroid_grid.build(_asteroids, _world_size);
+
+    // Contacts are found in parallel, one event list per chunk of bullets
+    int chunks = chunk_count((int)_bullets.size());
+    if ((int)_hit_events.size() < chunks)
+        _hit_events.resize(chunks);
+
+    parallel_chunks((int)_bullets.size(), [&](int c, cv::Range r)
     {
-        for (auto& a : _asteroids)
+        std::vector<std::pair<int, int>>& events = _hit_events[c];
+        events.clear();
+
+        for (int b = r.start; b < r.end; b++)
         {
-            if (b.collide(a))
+            cv::Point2f pos = _bullets.get_pos(b);
+            float radius = _bullets.get_radius(b);
+
+            _asteroid_grid.query(pos, radius, [&](size_t a)
             {
-                b.hit();
-                a.hit();
+                if (_asteroids.collide(a, pos, radius))
+                    events.push_back(std::make_pair(b, (int)a));
+            });
+        }
+    });
 
-                if (a.get_lives() <= 0)
+    // Applied in bullet order, so the outcome does not depend on the thread count
+    for (int c = 0; c < chunks; c++)
+    {
+        for (const std::pair<int, int>& e : _hit_events[c])
+        {
+            // A bullet is spent on its first hit; destroyed asteroids wait for the flush
+            if (_bullets.get_lives(e.first) > 0 && _asteroids.get_lives(e.second) > 0)
+            {
+                _bullets.hit(e.first);
+                _asteroids.hit(e.second);
+
+                if (_asteroids.get_lives(e.second) <= 0)
                     _score += 10;   // 10 points per asteroid
             }
         }
     }
 
     // Ship vs Asteroid
-    for (auto& a : _asteroids)
+    cv::Point2f ship_pos = _ship.get_pos();
+    float ship_radius = (float)_ship.get_radius();
+
+    _asteroid_grid.query(ship_pos, ship_radius, [&](size_t a)
     {
-        if (_ship.collide(a))
+        if (_asteroids.get_lives(a) > 0 && _asteroids.collide(a, ship_pos, ship_radius))
         {
             _ship.hit();
-            a.hit();
+            _asteroids.hit(a);
         }
+    });
 
-        if (_ship.get_lives() <= 0)
-        {
-            _ship.set_vel(Point2f(0, 0));
-            _game_over = true;
-        }
+    if (_ship.get_lives() <= 0)
+    {
+        _ship.set_vel(Point2f(0, 0));
+        _game_over = true;
     }
 }
 void CAsteroidGame::remove_dead_asteroids()
 {
-    _asteroids.erase(
-        std::remove_if(_asteroids.begin(), _asteroids.end(),
-            [](CAsteroid& a)
-            {
-                return a.get_lives() <= 0;
-            }),
-        _asteroids.end());
+    _asteroids.flush();
 }
 
 void CAsteroidGame::handle_micro_not_connected() {
     if (!_micro_connected)
     {
-        cv::putText(
-            _canvas,
-            "MICRO DISCONNECTED",
-            cv::Point(_canvas.cols / 4, _canvas.rows / 2),
-            cv::FONT_HERSHEY_SIMPLEX,
-            1.2,
-            cv::Scalar(0, 0, 255),
-            3
-        );
+        _layers.draw(_canvas, _layer_disconnected, 0, [](cv::Mat& im)
+        {
+            cv::putText(
+                im,
+                "MICRO DISCONNECTED",
+                cv::Point(im.cols / 4, im.rows / 2),
+                cv::FONT_HERSHEY_SIMPLEX,
+                1.2,
+                cv::Scalar(0, 0, 255),
+                3
+            );
+        });
     }
 }
 
 void CAsteroidGame::draw_points() {
-    std::string score_text = "Score: " + std::to_string(_score);
-
-    cv::putText(
-        _canvas,
-        score_text,
-        cv::Point(20, 90),
-        cv::FONT_HERSHEY_SIMPLEX,
-        0.8,
-        cv::Scalar(255, 255, 255),
-        2
-    );
+    char text[32];
+
+    std::snprintf(text, sizeof(text), "Bullets: %d", (int)_bullets.size());
+    _hud_text.draw(_canvas, text, cv::Point(20, 30), cv::Scalar(255, 255, 255));
+
+    std::snprintf(text, sizeof(text), "Lives: %d", _ship.get_lives());
+    _hud_text.draw(_canvas, text, cv::Point(20, 60), cv::Scalar(255, 255, 255));
+
+    std::snprintf(text, sizeof(text), "Score: %d", _score);
+    _hud_text.draw(_canvas, text, cv::Point(20, 90), cv::Scalar(255, 255, 255));
 }
 
 void CAsteroidGame::draw_game_over()
 {
     if (_game_over)
     {
-        cv::putText(
-            _canvas,
-            "GAME OVER - Press Reset",
-            cv::Point(_canvas.cols / 4, _canvas.rows / 2),
-            cv::FONT_HERSHEY_SIMPLEX,
-            1.2,
-            cv::Scalar(0, 0, 255),
-            3
-        );
+        _layers.draw(_canvas, _layer_game_over, 0, [](cv::Mat& im)
+        {
+            cv::putText(
+                im,
+                "GAME OVER - Press Reset",
+                cv::Point(im.cols / 4, im.rows / 2),
+                cv::FONT_HERSHEY_SIMPLEX,
+                1.2,
+                cv::Scalar(0, 0, 255),
+                3
+            );
+        });
     }
 }
 void CAsteroidGame::handle_game_reset()
@@ -356,6 +511,7 @@ void CAsteroidGame::handle_game_reset()
     if (_reset_requested)
     {
         reset_game();
+        tag_frame(_control.get_input_tag(DIGITAL, BUTTON_S1));
         _game_over = false;
         _reset_requested = false;
     }
@@ -367,14 +523,122 @@ void CAsteroidGame::reset_game()
     _bullets.clear();
 
     // Reset ship
-    _ship.set_pos(Point2f(_canvas.cols / 2.0f, _canvas.rows / 2.0f));
+    _ship.set_pos(Point2f(_world_size.width / 2.0f, _world_size.height / 2.0f));
+    _ship_prev = _ship.get_pos();
+
+    // The grid must not refer to the cleared asteroids
+    _asteroid_grid.build(_asteroids, _world_size);
     _ship.set_vel(Point2f(0.0f, 0.0f));
     _ship.set_angle(0.0f);
     _ship.set_lives(3);
     _score = 0;
+
+    _frame_changed = true;
 }
 
 CAsteroidGame::~CAsteroidGame()
 {
-    cv::destroyWindow(_window_name);
+    if (!_headless)
+        cv::destroyWindow(_window_name);
+}
+
+void CAsteroidGame::run_stress(int asteroids, int bullets_per_tick, int ticks, bool draw_frames)
+{
+    static const char* phase_names[STRESS_PHASES] = { "bot", "spawn", "ship", "bullets", "asteroids", "collide", "reclaim", "draw" };
+
+    // Pools sized for the load; a bullet lives at most a few hundred ticks
+    _asteroids = CEntityStore(std::max(asteroids, 4096));
+    _bullets = CEntityStore(std::max(bullets_per_tick * 400, 512));
+    reset_game();
+
+    _dt = SIM_DT;
+    _world = _canvas;
+    _world_scale = 1.0;
+
+    double phase_ms[STRESS_PHASES] = { 0 };
+    size_t peak_asteroids = 0;
+    size_t peak_bullets = 0;
+    size_t peak_commands = 0;
+    int interval_ticks = 0;
+    int64 interval_start = cv::getTickCount();
+    int64 mark = interval_start;
+
+    auto lap = [&](int phase)
+    {
+        int64 now = cv::getTickCount();
+        phase_ms[phase] += (now - mark) * 1000.0 / cv::getTickFrequency();
+        mark = now;
+    };
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "\nStress: " << asteroids << " asteroids, " << bullets_per_tick << " bullets per tick, "
+        << ticks << " ticks" << (draw_frames ? ", drawing" : "");
+
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        mark = cv::getTickCount();
+
+        // Bot: sweep the joystick so the ship crosses the board, fire a fan
+        double sweep = tick * 0.02;
+        _joy_x = 50.0 + 45.0 * cos(sweep);
+        _joy_y = 50.0 + 45.0 * sin(sweep * 0.7);
+        for (int k = 0; k < bullets_per_tick; k++)
+            fire(_ship.get_angle() + k * 6.2831853f / bullets_per_tick);
+        lap(0);
+
+        process_joystick();
+        update_ship();
+        lap(2);
+
+        update_bullets();
+        lap(3);
+
+        update_asteroids();
+        lap(4);
+
+        // After the step has started, as in update_asteroids(), so new asteroids are current
+        while (_asteroids.size() < (size_t)asteroids && _asteroids.size() < _asteroids.capacity())
+            spawn_asteroid();
+        lap(1);
+
+        remove_dead_asteroids();
+        lap(6);
+
+        handle_collisions();
+        _ship.set_lives(3);
+        _game_over = false;
+        lap(5);
+
+        remove_dead_bullets();
+        lap(6);
+
+        if (draw_frames)
+            draw();
+        lap(7);
+
+        peak_asteroids = std::max(peak_asteroids, _asteroids.size());
+        peak_bullets = std::max(peak_bullets, _bullets.size());
+        peak_commands = std::max(peak_commands, _draw_list.size());
+
+        if (++interval_ticks < STRESS_REPORT_TICKS && tick < ticks - 1)
+            continue;
+
+        double interval_s = (cv::getTickCount() - interval_start) / cv::getTickFrequency();
+
+        std::cout << "\nTick " << tick + 1 << ": " << std::setprecision(0) << interval_ticks / interval_s
+            << " ticks/s" << std::setprecision(3) << " |";
+        for (int p = 0; p < STRESS_PHASES; p++)
+        {
+            std::cout << " " << phase_names[p] << " " << phase_ms[p] / interval_ticks;
+            phase_ms[p] = 0.0;
+        }
+        std::cout << " ms | live " << _asteroids.size() << " asteroids " << _bullets.size() << " bullets"
+            << " | peak " << peak_asteroids << " asteroids " << peak_bullets << " bullets "
+            << peak_commands << " draw commands | peak memory " << std::setprecision(1) << peak_memory_mb()
+            << " MB" << std::setprecision(3);
+
+        interval_ticks = 0;
+        interval_start = cv::getTickCount();
+    }
+    std::cout << "\nScore " << _score << "\n";
 }
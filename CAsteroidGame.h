@@ -2,11 +2,14 @@
 
 #include "CBase4618.h"
 #include "CShip.h"
-#include "CAsteroid.h"
-#include "CBullet.h"
+#include "CEntityStore.h"
+#include "CSpatialGrid.h"
+#include "CParallel.h"
+#include "CTextRenderer.h"
 
 #include <vector>
 #include <string>
+#include <utility>
 
 /**
  * @class CAsteroidGame
@@ -41,8 +44,9 @@ public:
      *
      * @param size    Window resolution.
      * @param comport COM port number.
+     * @param headless True to skip the window and serial port (stress runs).
      */
-    CAsteroidGame(cv::Size size, int comport);
+    CAsteroidGame(cv::Size size, int comport, bool headless = false);
 
     /**
      * @brief Destructor.
@@ -64,33 +68,57 @@ public:
      *
      * Performs:
      * - Timing update
-     * - Ship movement
-     * - Bullet updates
-     * - Asteroid spawning and movement
-     * - Collision detection
+     * - Fixed-length simulation steps for the elapsed time, each with:
+     *   - Ship movement
+     *   - Bullet updates
+     *   - Asteroid spawning and movement
+     *   - Collision detection
      * - Game state transitions
      */
     void update();
 
     /**
-     * @brief Render game objects to screen.
+     * @brief Render game objects to the world target.
      *
      * Draws:
      * - Ship
      * - Bullets
      * - Asteroids
-     * - UI text
+     *
+     * The screen shows the part of the larger world under a camera that
+     * follows the ship. Only asteroids in grid cells around the view are
+     * submitted. The world target may be scaled down by dynamic resolution.
      */
     void draw();
 
-private:
+    /**
+     * @brief Render UI text at native resolution.
+     *
+     * Draws the bullet, lives and score lines and the status messages.
+     */
+    void draw_overlay();
 
-    ////////////////////////
-    /// Window
-    ////////////////////////
+    /**
+     * @brief Runs the game headless under synthetic load as fast as possible.
+     *
+     * A scripted bot steers the ship and fires a fan of bullets every tick,
+     * and the asteroid count is topped up to a target each tick. The ship
+     * cannot die. Every tick runs the same update steps as update() with a
+     * fixed 60 Hz time step, without the window, serial port or frame
+     * pacing. Ticks per second, per-phase times, live and high-water entity
+     * counts and the process' peak memory are printed periodically, so a
+     * steady climb in any of them over a long run points to a leak.
+     *
+     * @param asteroids Asteroids kept alive
+     * @param bullets_per_tick Bullets fired every tick
+     * @param ticks Ticks to run
+     * @param draw_frames True to also build and rasterize the world each tick
+     */
+    void run_stress(int asteroids, int bullets_per_tick, int ticks, bool draw_frames);
 
-    std::string _window_name = "Lab 6 Asteroid"; ///< OpenCV window name
+private:
 
+    bool _headless; ///< True if created for run_stress() without a window
 
     ////////////////////////
     /// Micro Connection
@@ -112,10 +140,21 @@ private:
     /// Timing
     ////////////////////////
 
-    void update_timing(); ///< Update frame delta time
+    void update_timing(); ///< Update the simulation step length
+    void step();          ///< Advance the game by one fixed step of _dt
+
+    double _dt;        ///< Length of one simulation step (seconds)
+
+
+    ////////////////////////
+    /// World and camera
+    ////////////////////////
+
+    cv::Size _world_size; ///< Playing field; larger than the screen
+    cv::Point2f _camera;  ///< World position of the screen's top-left corner this frame
 
-    double _last_time; ///< Previous frame time
-    double _dt;        ///< Delta time between frames
+    cv::Point2f camera_for(cv::Point2f focus) const; ///< Camera origin centred on a point, kept inside the world
+    cv::Rect2f near_rect();                          ///< World area simulated every step: the view plus a margin
 
 
     ////////////////////////
@@ -133,11 +172,13 @@ private:
     ////////////////////////
 
     CShip _ship; ///< Player ship object
+    Point2f _ship_prev; ///< Ship position before the last step, for interpolated drawing
 
     void process_joystick();              ///< Apply joystick acceleration
     void update_ship();                   ///< Update ship position
-    void clamp_object(CGameObject& obj);  ///< Clamp object to screen bounds
+    void clamp_object(CGameObject& obj);  ///< Clamp object to world bounds
     void draw_ship();                     ///< Draw ship
+    cv::Point2f ship_draw_pos();          ///< Ship position blended between the last two steps
 
     double _joy_y = 0;      ///< Joystick Y value
     double _joy_x = 0;      ///< Joystick X value
@@ -146,18 +187,26 @@ private:
      ////////////////////////
      /// Ship
      ////////////////////////
-    void draw_points(); ///< Draws player's point 
+    void draw_points(); ///< Draws bullet count, lives and player's points
     int _score = 0;   ///< ship score
 
+    CTextRenderer _hud_text{ 0.8, 2 }; ///< Font for the bullets, lives and score lines
+
+    CDrawList _draw_list; ///< Ship, bullet and asteroid primitives for the current frame
+
+    int _layer_disconnected; ///< Cached "MICRO DISCONNECTED" banner
+    int _layer_game_over;    ///< Cached game over banner
+
     ////////////////////////
     /// Bullets
     ////////////////////////
 
-    std::vector<CBullet> _bullets; ///< Active bullets
+    CEntityStore _bullets{ 512 }; ///< Active bullets
 
     void handle_fire_request();   ///< Spawn bullet if requested
+    void fire(float angle);       ///< Spawn a bullet at the ship heading in a direction
     void update_bullets();        ///< Update bullet movement
-    void remove_dead_bullets();   ///< Remove bullets that are destroyed
+    void remove_dead_bullets();   ///< Reclaim bullets that hit or left the screen
     void draw_bullets();          ///< Draw bullets
 
     bool _fire_requested = false; ///< Fire button flag
@@ -167,13 +216,17 @@ private:
     /// Asteroids
     ////////////////////////
 
-    std::vector<CAsteroid> _asteroids; ///< Active asteroids
+    CEntityStore _asteroids{ 4096 };   ///< Active asteroids; spawning pauses when full
+    CSpatialGrid _asteroid_grid;       ///< Asteroids by cell, rebuilt before collision tests
+    std::vector<std::vector<std::pair<int, int>>> _hit_events; ///< (bullet, asteroid) contacts found by each bullet chunk
+    std::vector<int> _near_asteroids;    ///< Asteroids near the view or a bullet, advanced every step
+    std::vector<int> _visible_asteroids; ///< Asteroids submitted for drawing this frame
+    int _lod_phase;                      ///< Background slice advanced this step
 
     void handle_collisions();          ///< Detect and resolve collisions
-    void wrap_object(CGameObject& obj);///< Wrap object around screen
-    void update_asteroids();           ///< Update asteroid movement and spawning
+    void update_asteroids();           ///< Spawn, and move asteroids near the view or a bullet every step and the rest in slices
     void spawn_asteroid();             ///< Create new asteroid
-    void remove_dead_asteroids();      ///< Remove destroyed asteroids
+    void remove_dead_asteroids();      ///< Reclaim destroyed asteroids
     void draw_asteroids();             ///< Draw asteroids
 
     double _asteroid_spawn_timer = 0.0;    ///< Spawn timer accumulator
@@ -1,28 +1,554 @@
 #include "stdafx.h"
 #include "CBase4618.h"
 #include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+#include "cvui.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+
+CInputLog::Mode CBase4618::_input_log_mode = CInputLog::OFF;
+std::string CBase4618::_input_log_path;
+bool CBase4618::_gdi_present = false;
+bool CBase4618::_indexed_mode = false;
+
+#define DYNRES_MIN      0.5    // smallest world scale
+#define DYNRES_STEP     0.05   // scale change per controller decision
+#define DYNRES_HEADROOM 0.8    // scale up only below this fraction of the budget
+#define DYNRES_COOLDOWN 15     // frames between scale changes
+#define DYNRES_SMOOTH   0.1    // weight of a new sample in the average
+
+#define SIM_MAX_STEPS   5      // fixed simulation steps per frame before the backlog is dropped
+
+static double elapsed_ms(int64 start_tick, int64 end_tick)
+{
+    return (end_tick - start_tick) * 1000.0 / cv::getTickFrequency();
+}
 
 CBase4618::CBase4618()
 {
     _exit = false;
+    _back_buffer = 0;
+
+    _hud_frame = _perf_hud.add_series("frame", 0xFFFFFF);
+    _hud_gpio = _perf_hud.add_series("gpio", 0x00FF00);
+    _hud_update = _perf_hud.add_series("update", 0x00FFFF);
+    _hud_draw = _perf_hud.add_series("draw", 0xFF8000);
+    _hud_present = _perf_hud.add_series("pres", 0x8080FF);
+
+    _gdi_tried = false;
+
+    _world_scale = 1.0;
+    _world_target = false;
+    _dynres_enabled = false;
+    _render_scale = 1.0;
+    _frame_budget_ms = 16.7;
+    _render_ms_avg = 0.0;
+    _dynres_cooldown = 0;
+    _dynres_changes = 0;
+    _hud_scale = -1;
+
+    _indexed_supported = false;
+    _indexed = false;
+    for (int i = 0; i < 256; i++)
+        _palette[i] = cv::Vec3b((uchar)i, (uchar)i, (uchar)i);   // grey ramp until set
+    _present_ms_sum = 0.0;
+    _present_count = 0;
+
+    _late_latch = false;
+    _hud_latch = -1;
+
+    _frame_input.id = 0;
+    _frame_input.time = 0.0;
+    _last_traced_id = 0;
+    _input_latency.set_capacity(4096);
+    _hud_input = _perf_hud.add_series("in>px", 0x0080FF);
+
+    _frame_changed = true;
+    _idle_enabled = false;
+    _idle_wait_ms = 100;
+    _idle_after_frames = 30;
+    _unchanged_frames = 0;
+
+    _frame_dt = 0.0;
+    _sim_dt = 0.0;
+    _sim_accumulator = 0.0;
+    _sim_alpha = 1.0;
+    _rng_seed = (unsigned int)time(NULL);
+
+    _control.set_input_log(&_input_log);
+
+    if (_input_log_mode == CInputLog::RECORD && !_input_log.open_record(_input_log_path))
+        std::cout << "\nCould not create input log " << _input_log_path;
+    if (_input_log_mode == CInputLog::REPLAY && !_input_log.open_replay(_input_log_path))
+        std::cout << "\nCould not open input log " << _input_log_path;
+
+    // Frame 0 covers the derived constructor and stores the base seed
+    double dt = 0.0;
+    _input_log.begin_frame(dt, _rng_seed);
+    srand(_rng_seed);
+    _frame_seed = _rng_seed;
+}
+
+void CBase4618::set_input_log(CInputLog::Mode mode, const std::string& path)
+{
+    _input_log_mode = mode;
+    _input_log_path = path;
+}
+
+int CBase4618::log_input(int value)
+{
+    if (_input_log.is_replaying())
+        _input_log.replay(value);
+    else
+        _input_log.record(value, true);
+    return value;
 }
 
 CBase4618::~CBase4618()
 {
 }
 
+void CBase4618::set_gdi_present(bool enable)
+{
+    _gdi_present = enable;
+}
+
+void CBase4618::set_indexed_mode(bool enable)
+{
+    _indexed_mode = enable;
+}
+
+void CBase4618::set_palette(int index, const cv::Scalar& bgr)
+{
+    _palette[index & 0xFF] = cv::Vec3b(cv::saturate_cast<uchar>(bgr[0]),
+        cv::saturate_cast<uchar>(bgr[1]), cv::saturate_cast<uchar>(bgr[2]));
+}
+
+void CBase4618::setup_indexed()
+{
+    _indexed = _indexed_mode && _indexed_supported && !_canvas.empty();
+    if (!_indexed)
+        return;
+
+    _index_buffers[0] = cv::Mat::zeros(_canvas.size(), CV_8UC1);
+    _index_buffers[1] = cv::Mat::zeros(_canvas.size(), CV_8UC1);
+
+    // Scaled worlds are indexed too; their expansion is staged at BGR
+    _world_bgr = _world_full;
+    _world_full = cv::Mat::zeros(_canvas.size(), CV_8UC1);
+
+    _world_dirty.reserve(32);
+}
+
+void CBase4618::expand_palette(const cv::Rect& r, cv::Mat& bgr) const
+{
+    // One byte read and three written per pixel, once per frame
+    for (int y = r.y; y < r.y + r.height; y++)
+    {
+        const uchar* s = _world.ptr<uchar>(y) + r.x;
+        cv::Vec3b* d = bgr.ptr<cv::Vec3b>(y) + r.x;
+
+        for (int x = 0; x < r.width; x++)
+            d[x] = _palette[s[x]];
+    }
+}
+
+void CBase4618::resolve_world()
+{
+    if (_world.data == _canvas.data)
+        return;
+
+    if (!_indexed)
+    {
+        cv::resize(_world, _canvas, _canvas.size(), 0, 0, cv::INTER_LINEAR);
+        _damage.clear();    // every canvas pixel was resampled
+        return;
+    }
+
+    bool scaled = _world.size() != _canvas.size();
+    cv::Mat bgr = scaled ? _world_bgr(cv::Rect(0, 0, _world.cols, _world.rows)) : _canvas;
+
+    cv::Rect full(0, 0, _world.cols, _world.rows);
+
+    if (scaled || _world_dirty.empty())
+    {
+        expand_palette(full, bgr);
+    }
+    else
+    {
+        for (const cv::Rect& r : _world_dirty)
+            expand_palette(r & full, bgr);
+    }
+
+    if (scaled)
+    {
+        cv::resize(bgr, _canvas, _canvas.size(), 0, 0, cv::INTER_LINEAR);
+        _damage.clear();    // every canvas pixel was resampled
+    }
+}
+
+void CBase4618::set_dynamic_resolution(bool enable, double budget_ms)
+{
+    _dynres_enabled = enable && _world_target;
+    _frame_budget_ms = budget_ms;
+    _render_ms_avg = budget_ms;
+    _dynres_cooldown = 0;
+
+    if (_dynres_enabled && _hud_scale < 0)
+        _hud_scale = _perf_hud.add_series("res%", 0xFFFF00);
+    if (!_dynres_enabled)
+        _render_scale = 1.0;
+}
+
+void CBase4618::update_render_scale(double render_ms)
+{
+    _render_ms_avg += DYNRES_SMOOTH * (render_ms - _render_ms_avg);
+    _perf_hud.add_sample(_hud_scale, _render_scale * 100.0);
+
+    if (_dynres_cooldown > 0)
+    {
+        _dynres_cooldown--;
+        return;
+    }
+
+    double scale = _render_scale;
+    if (_render_ms_avg > _frame_budget_ms)
+        scale = std::max(DYNRES_MIN, scale - DYNRES_STEP);
+    else if (_render_ms_avg < DYNRES_HEADROOM * _frame_budget_ms)
+        scale = std::min(1.0, scale + DYNRES_STEP);
+
+    if (scale != _render_scale)
+    {
+        _render_scale = scale;
+        _dynres_changes++;
+        _dynres_cooldown = DYNRES_COOLDOWN;
+    }
+}
+
+void CBase4618::set_idle_policy(bool enable, int idle_wait_ms, int idle_after_frames)
+{
+    _idle_enabled = enable;
+    _idle_wait_ms = idle_wait_ms;
+    _idle_after_frames = idle_after_frames;
+    _unchanged_frames = 0;
+}
+
+void CBase4618::set_fixed_timestep(double dt)
+{
+    _sim_dt = std::max(0.0, dt);
+    _sim_accumulator = 0.0;
+    _sim_alpha = 1.0;
+}
+
+int CBase4618::fixed_steps()
+{
+    if (_sim_dt <= 0.0)
+        return 1;
+
+    // _frame_dt is the recorded value on replay, so the step count replays too
+    _sim_accumulator += _frame_dt;
+
+    int steps = 0;
+    while (_sim_accumulator >= _sim_dt && steps < SIM_MAX_STEPS)
+    {
+        _sim_accumulator -= _sim_dt;
+        steps++;
+    }
+
+    if (_sim_accumulator >= _sim_dt)
+        _sim_accumulator = std::fmod(_sim_accumulator, _sim_dt);
+
+    _sim_alpha = _sim_accumulator / _sim_dt;
+    return steps;
+}
+
+void CBase4618::set_late_latch(bool enable)
+{
+    _late_latch = enable && !_latch_channels.empty();
+
+    if (_late_latch)
+    {
+        if (_hud_latch < 0)
+            _hud_latch = _perf_hud.add_series("latch", 0xFF00FF);
+
+        _control.start_polling(_latch_channels);
+    }
+    else
+    {
+        _control.stop_polling();
+    }
+}
+
+bool CBase4618::latch_analog(int channel, double& percent)
+{
+    if (!_late_latch)
+        return false;
+
+    InputTag gpio_tag = _control.get_input_tag(ANALOG, channel);
+    InputTag latched_tag;
+    double latched = 0.0;
+
+    // CControl decides whether the sample is newer, so replays latch the same frames
+    if (!_control.get_analog_cached(channel, latched, latched_tag))
+    {
+        _perf_hud.add_sample(_hud_latch, 0.0);
+        return false;
+    }
+
+    // How much fresher the latched sample is than the gpio() sample. Replayed
+    // samples are tagged when they are read back, so the gain is not known.
+    if (_input_log.is_replaying())
+    {
+        percent = latched;
+        return true;
+    }
+    double saved_ms = (latched_tag.time - gpio_tag.time) * 1000.0;
+    _perf_hud.add_sample(_hud_latch, saved_ms);
+    percent = latched;
+    return true;
+}
+
+void CBase4618::create_canvas(cv::Size size, int type)
+{
+    _buffers[0] = cv::Mat::zeros(size, type);
+    _buffers[1] = cv::Mat::zeros(size, type);
+
+    _back_buffer = 0;
+    _canvas = _buffers[_back_buffer];
+    _world = _canvas;
+
+    // Scaled world targets are regions of this, so changing scale never allocates
+    _world_full = cv::Mat::zeros(size, type);
+
+    _damage.reserve(32);
+}
+
+void CBase4618::add_damage(const cv::Rect& r)
+{
+    cv::Rect clipped = r & cv::Rect(0, 0, _canvas.cols, _canvas.rows);
+    if (!clipped.empty())
+        _damage.push_back(clipped);
+}
+
+void CBase4618::present()
+{
+    // The overlay is drawn over the frame, so it is damaged whenever shown
+    if (!_damage.empty() && _perf_hud.is_visible())
+        add_damage(_perf_hud.get_rect(_canvas.size()));
+
+    _perf_hud.draw(_canvas);
+    cvui::update(_window_name);
+
+    // The canvas size is only known once the derived constructor has run
+    if (_gdi_present && !_gdi_tried)
+    {
+        _gdi_tried = true;
+        if (!_gdi.open(_window_name, _canvas.size()))
+            std::cout << "\nGDI presenter unavailable, using HighGUI";
+    }
+
+    int64 present_start = cv::getTickCount();
+    if (_gdi.is_open())
+        _gdi.present(_canvas, _damage);
+    else
+        cv::imshow(_window_name, _canvas);
+
+    double present_ms = elapsed_ms(present_start, cv::getTickCount());
+    _perf_hud.add_sample(_hud_present, present_ms);
+    _present_ms_sum += present_ms;
+    _present_count++;
+
+    // A held input keeps its tag across frames; count each sample once
+    if (_frame_input.id != 0 && _frame_input.id != _last_traced_id)
+    {
+        double now = cv::getTickCount() / cv::getTickFrequency();
+        double latency_ms = (now - _frame_input.time) * 1000.0;
+
+        _input_latency.push(latency_ms);
+        _perf_hud.add_sample(_hud_input, latency_ms);
+        _last_traced_id = _frame_input.id;
+    }
+
+    _damage.clear();
+
+    // Header swap only; both buffers stay allocated for the whole session
+    _back_buffer ^= 1;
+    _canvas = _buffers[_back_buffer];
+}
+
+void CBase4618::tag_frame(const InputTag& tag)
+{
+    // Replayed samples arrive when they are read back, so their latency is meaningless
+    if (tag.id == 0 || _input_log.is_replaying())
+        return;
+
+    if (_frame_input.id == 0 || tag.time < _frame_input.time)
+        _frame_input = tag;
+}
+
+void CBase4618::report_input_latency()
+{
+    if (_input_latency.empty())
+        return;
+
+    std::vector<double> sorted;
+    _input_latency.copy_to(sorted);
+    std::sort(sorted.begin(), sorted.end());
+
+    size_t n = sorted.size();
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "\nInput-to-display latency over " << n << " inputs (ms):"
+        << " min " << sorted[0]
+        << " p50 " << sorted[n / 2]
+        << " p90 " << sorted[(n * 9) / 10]
+        << " p99 " << sorted[(n * 99) / 100]
+        << " max " << sorted[n - 1];
+}
+
 void CBase4618::run()
 {
+    int64 frame_start = cv::getTickCount();
+    unsigned int frame_index = 0;
+
+    setup_indexed();
 
     while (!_exit)
     {
-        int key = cv::waitKey(1);
-        if (key == 'q' || key == 'Q')
+        // Replays run flat out so benchmarks are not limited by the idle rate
+        bool idle = is_idle() && !_input_log.is_replaying();
+
+        int key = cv::waitKey(idle ? _idle_wait_ms : 1);
+        if (_gdi.is_open())
+        {
+            int gdi_key = _gdi.poll_key();
+            if (gdi_key != -1)
+                key = gdi_key;
+        }
+
+        // Keys and mouse activity (cvui hover and clicks) wake the loop at once
+        if (_idle_enabled)
+        {
+            cv::Point mouse = cvui::mouse();
+            if (key != -1 || mouse != _last_mouse || cvui::mouse(cvui::IS_DOWN))
+                _unchanged_frames = 0;
+            _last_mouse = mouse;
+        }
+        idle = idle && _unchanged_frames > 0;
+
+        // Replay overwrites dt and seed with the recorded values
+        _frame_dt = elapsed_ms(frame_start, cv::getTickCount()) / 1000.0;
+        unsigned int seed = _rng_seed + ++frame_index;
+
+        if (!_input_log.begin_frame(_frame_dt, seed))
+            break;
+        srand(seed);
+        _frame_seed = seed;
+
+        // Keys go through the log, so a replay toggles the same settings on
+        // the same frames; 'q' still ends a replay early
+        bool quit = key == 'q' || key == 'Q';
+        key = log_input(key);
+        if (quit || key == 'q' || key == 'Q')
             _exit = true;
+        if (key == 'p' || key == 'P')
+            _perf_hud.toggle();
+        if (key == 'l' || key == 'L')
+            set_late_latch(!_late_latch);
+        if (key == 'r' || key == 'R')
+            set_dynamic_resolution(!_dynres_enabled, _frame_budget_ms);
 
+        // Latching changes which samples the frame reads, so the state it
+        // was recorded with wins, including the one it started in
+        bool latch = log_action(_late_latch);
+        if (latch != _late_latch)
+            set_late_latch(latch);
+
+        _frame_changed = false;
+        _frame_input.id = 0;
+
+        int64 gpio_start = cv::getTickCount();
         gpio();
+        int64 update_start = cv::getTickCount();
         update();
-        draw();
+        int64 draw_start = cv::getTickCount();
+
+        // An idle, unchanged frame is already on screen
+        if (!idle || _frame_changed)
+        {
+            // Region of the native-size store at the chosen scale, or the canvas itself
+            if (_dynres_enabled && _render_scale < 1.0)
+            {
+                int w = std::max(1, (int)(_canvas.cols * _render_scale + 0.5));
+                int h = std::max(1, (int)(_canvas.rows * _render_scale + 0.5));
+                _world = _world_full(cv::Rect(0, 0, w, h));
+                _world_scale = (double)w / _canvas.cols;
+            }
+            else
+            {
+                // The indexed swap chain flips with the BGR one, so both have the same age
+                _world = _indexed ? _index_buffers[_back_buffer] : _canvas;
+                _world_scale = 1.0;
+            }
+            _world_dirty.clear();
+
+            draw();
+            resolve_world();
+
+            draw_overlay();
+            present();
+
+            if (_dynres_enabled)
+                update_render_scale(elapsed_ms(draw_start, cv::getTickCount()));
+        }
+        int64 draw_end = cv::getTickCount();
+
+        if (_frame_changed)
+            _unchanged_frames = 0;
+        else if (_unchanged_frames < _idle_after_frames)
+            _unchanged_frames++;
+
+        _perf_hud.add_sample(_hud_gpio, elapsed_ms(gpio_start, update_start));
+        _perf_hud.add_sample(_hud_update, elapsed_ms(update_start, draw_start));
+        _perf_hud.add_sample(_hud_draw, elapsed_ms(draw_start, draw_end));
+
+        // Full loop time, including waitKey and any pacing done in update()
+        _perf_hud.add_sample(_hud_frame, elapsed_ms(frame_start, draw_end));
+        frame_start = draw_end;
+    }
+
+    report_input_latency();
 
+    if (_present_count > 0)
+    {
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "\nPresented " << _present_count << " frames with "
+            << (_gdi.is_open() ? "GDI DIB section" : "HighGUI imshow")
+            << ", average present " << _present_ms_sum / _present_count << " ms";
+    }
+    _gdi.close();
+
+    if (_dynres_changes > 0 || _dynres_enabled)
+    {
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "\nDynamic resolution: " << _dynres_changes << " scale changes, final scale "
+            << _render_scale << ", smoothed draw + present " << _render_ms_avg
+            << " ms (budget " << _frame_budget_ms << " ms)";
+    }
+
+    if (_layers.get_hits() + _layers.get_misses() > 0)
+    {
+        std::cout << "\nLayers: " << _layers.get_hits() << " composited from cache, "
+            << _layers.get_misses() << " redrawn";
+    }
+
+    if (_input_log.is_replaying())
+    {
+        std::cout << "\nReplayed " << _input_log.get_frame_count() << " frames, "
+            << _input_log.get_desync_count() << " out of sync";
     }
+    _input_log.close();
 }
\ No newline at end of file
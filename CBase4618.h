@@ -1,7 +1,14 @@
 #pragma once
 
 #include "CControl.h"
+#include "CPerfHUD.h"
+#include "CInputLog.h"
+#include "CRingBuffer.h"
+#include "CGdiPresenter.h"
+#include "CLayerCache.h"
 #include <opencv2/core.hpp>
+#include <string>
+#include <vector>
 
 /**
  * @file CBase4618.h
@@ -17,16 +24,285 @@
   * @brief Base class providing the main application loop and shared resources.
   *
   * CBase4618 defines a standard run loop that repeatedly calls update and draw.
-  * The loop exits when the user presses the 'q' key.
+  * The loop exits when the user presses the 'q' key. Pressing 'p' toggles a
+  * performance overlay showing frame, gpio, update and draw times.
   * Derived classes implement application-specific behavior.
+  *
+  * The base class also owns the frame delta time and the rand() seed. Each
+  * frame is reseeded, and together with an optional CInputLog this lets a
+  * session be recorded and replayed with identical inputs, dt and random
+  * numbers for benchmarking.
+  *
+  * With the idle policy enabled, applications set _frame_changed whenever
+  * input or an event changes what is shown. After a run of unchanged frames
+  * the loop drops to a low refresh rate and skips draw(), and it returns to
+  * full rate on the first changed frame, key press or mouse activity.
+  *
+  * Late latching ('l' key) polls the channels in _latch_channels on a
+  * background thread. latch_analog() then re-reads the newest sample right
+  * before it is used, instead of relying on the value read in gpio(). The
+  * age reduction is shown as the "latch" series in the performance overlay.
+  *
+  * Input-to-display latency is traced with the InputTag of each sample.
+  * Applications pass the tags of the inputs a frame reacts to into
+  * tag_frame() during gpio() or update(), and present() records the time
+  * from the oldest of them arriving in CControl to the frame being shown.
+  *
+  * The canvas is the back buffer of a two-buffer swap chain allocated once by
+  * create_canvas(). draw() renders into _canvas and run() presents it and
+  * flips, so at the start of the next draw() _canvas refers to the other
+  * buffer, which still holds the frame presented two frames earlier.
+  *
+  * Applications that only redraw part of the canvas report the changed
+  * regions with add_damage(). A frame with no damage reported is treated as
+  * fully changed. The GDI presenter converts and blits only those regions;
+  * cv::imshow always copies the whole frame.
+  *
+  * set_gdi_present() switches presentation from cv::imshow to a Win32
+  * window backed by a GDI DIB section (CGdiPresenter), which converts and
+  * blits only the damaged regions. The "pres" overlay series and the
+  * summary printed on exit compare the two backends.
+  *
+  * Applications that set _world_target draw their scene into _world,
+  * scaling world coordinates by _world_scale, and draw text and widgets in
+  * draw_overlay(). With dynamic resolution enabled ('r' key) _world is a
+  * reduced-size target whose scale is chosen each frame to keep draw and
+  * present time within a budget; it is upscaled into _canvas before the
+  * overlay, so text and the HUD stay at native resolution.
+  *
+  * Applications that set _indexed_supported and draw their world with
+  * pen() colours can run with an 8-bit indexed world (set_indexed_mode()).
+  * _world is then a one byte per pixel swap chain that flips together with
+  * the BGR buffers, and the palette is applied once per frame when the
+  * world is resolved into _canvas, only inside _world_dirty when the
+  * application reports it.
   */
 class CBase4618
 {
 protected:
     CControl _control;   ///< Hardware control interface
-    cv::Mat  _canvas;    ///< OpenCV canvas used for drawing
+    cv::Mat  _canvas;    ///< OpenCV canvas used for drawing (current back buffer)
     bool _exit;         ///< Exit flag
 
+    cv::Mat _buffers[2];      ///< Swap chain, allocated once by create_canvas()
+    int _back_buffer;         ///< Index of the buffer _canvas refers to
+    std::string _window_name; ///< Window the swap chain is presented in
+
+    /**
+     * @brief Allocates the swap chain and points _canvas at the back buffer.
+     *
+     * Called once from the derived constructor. Both buffers start black.
+     *
+     * @param size Canvas size in pixels
+     * @param type OpenCV pixel type
+     */
+    void create_canvas(cv::Size size, int type = CV_8UC3);
+
+    std::vector<cv::Rect> _damage; ///< Regions changed since the last present (empty = whole frame)
+
+    CGdiPresenter _gdi;      ///< DIB section presenter, open if selected and available
+    bool _gdi_tried;         ///< True once opening the presenter has been attempted
+    int _hud_present;        ///< HUD series: present() time
+    double _present_ms_sum;  ///< Total present() time, for the exit summary
+    int _present_count;      ///< Frames presented
+
+    static bool _gdi_present; ///< Presenter selection applied to new applications
+
+    cv::Mat _world;          ///< World target for this frame: _canvas, or a scaled region of _world_full
+    cv::Mat _world_full;     ///< Native-size storage behind the scaled world target
+    double _world_scale;     ///< _world size relative to _canvas for this frame
+    bool _world_target;      ///< Set by applications that draw their scene into _world
+    bool _dynres_enabled;    ///< True if the render scale follows the frame budget
+    double _render_scale;    ///< Scale chosen by the controller (DYNRES_MIN to 1)
+    double _frame_budget_ms; ///< Target draw + present time
+    double _render_ms_avg;   ///< Smoothed draw + present time
+    int _dynres_cooldown;    ///< Frames until the controller may change scale again
+    int _dynres_changes;     ///< Scale changes made so far
+    int _hud_scale;          ///< HUD series: render scale in percent (-1 until enabled)
+
+    CLayerCache _layers;     ///< Cached banners, panels and widgets declared by the application
+
+    bool _indexed_supported; ///< Set by applications that draw their world with pen()
+    bool _indexed;           ///< True if _world holds palette indices this session
+    cv::Mat _index_buffers[2];        ///< Indexed world swap chain (indexed mode only)
+    cv::Mat _world_bgr;               ///< Native-size BGR staging for a scaled indexed world
+    cv::Vec3b _palette[256];          ///< Index to BGR colour
+    std::vector<cv::Rect> _world_dirty; ///< Regions of an indexed _world changed this frame (empty = all)
+
+    static bool _indexed_mode; ///< Indexed world selection applied to new applications
+
+    /**
+     * @brief Colour to draw with in _world.
+     *
+     * @param index Palette index
+     * @return Scalar(index) in indexed mode, otherwise the palette colour
+     */
+    cv::Scalar pen(int index) const
+    {
+        const cv::Vec3b& c = _palette[index & 0xFF];
+        return _indexed ? cv::Scalar(index & 0xFF) : cv::Scalar(c[0], c[1], c[2]);
+    }
+
+    /**
+     * @brief Sets a palette entry.
+     *
+     * @param index Palette index (0 to 255)
+     * @param bgr Colour shown for the index
+     */
+    void set_palette(int index, const cv::Scalar& bgr);
+
+    /** @brief Allocates the indexed swap chain if the application and the selection allow it. */
+    void setup_indexed();
+
+    /**
+     * @brief Writes the palette colours of an indexed _world region.
+     *
+     * @param r Region of _world, already clipped
+     * @param bgr Destination the same size as _world (CV_8UC3)
+     */
+    void expand_palette(const cv::Rect& r, cv::Mat& bgr) const;
+
+    /**
+     * @brief Resolves _world into _canvas after draw().
+     *
+     * Expands palette indices and/or upscales a reduced-resolution world.
+     * Does nothing when _world is the canvas itself.
+     */
+    void resolve_world();
+
+    /**
+     * @brief Draws text and widgets at native resolution.
+     *
+     * Called after the world target has been resolved into _canvas and
+     * before present(). Applications without a world target can ignore it.
+     */
+    virtual void draw_overlay() {}
+
+    /**
+     * @brief Feeds one frame's draw + present time to the scale controller.
+     *
+     * @param render_ms Time spent in draw, resolve, overlay and present
+     */
+    void update_render_scale(double render_ms);
+
+    /**
+     * @brief Marks a region of the back buffer as changed since the last present.
+     *
+     * @param r Changed region, clipped to the canvas
+     */
+    void add_damage(const cv::Rect& r);
+
+    CPerfHUD _perf_hud;  ///< Frame timing overlay
+    int _hud_frame;      ///< HUD series: full loop time
+    int _hud_gpio;       ///< HUD series: gpio() time
+    int _hud_update;     ///< HUD series: update() time
+    int _hud_draw;       ///< HUD series: draw() time (including present)
+
+    CInputLog _input_log;    ///< Input recorder / replayer shared with _control
+    double _frame_dt;        ///< Time since the previous frame started (seconds)
+    unsigned int _rng_seed;  ///< Base seed; frame n uses _rng_seed + n
+    unsigned int _frame_seed; ///< Seed of the current frame (as recorded or replayed)
+
+    /**
+     * @brief Records a value the frame reacts to, or replaces it on replay.
+     *
+     * For inputs that do not come through CControl: keys, cvui widgets and
+     * loop settings. Call it from gpio() or update(), which run every frame
+     * in both modes, not from draw().
+     *
+     * @param value Live value
+     * @return The live value, or the recorded one while replaying
+     */
+    int log_input(int value);
+
+    /// @brief log_input() for a one-frame event such as a button click.
+    bool log_action(bool happened) { return log_input(happened ? 1 : 0) != 0; }
+
+    double _sim_dt;          ///< Fixed simulation step (seconds), 0 to step once per frame
+    double _sim_accumulator; ///< Frame time not yet simulated (seconds)
+    double _sim_alpha;       ///< Position of the drawn frame between the previous and current step (0..1)
+
+    /**
+     * @brief Sets the fixed simulation step used by fixed_steps().
+     *
+     * @param dt Step in seconds, or 0 to run one step of any length per frame
+     */
+    void set_fixed_timestep(double dt);
+
+    /**
+     * @brief Banks this frame's time and returns how many fixed steps to run.
+     *
+     * Whole steps are taken out of the accumulator and the remainder sets
+     * _sim_alpha, so draw() can blend the previous and current state. At
+     * most SIM_MAX_STEPS run per frame; after a longer stall the backlog is
+     * dropped instead of making the next frames slower still.
+     *
+     * @return Number of steps of _sim_dt to simulate this frame
+     */
+    int fixed_steps();
+
+    bool _frame_changed;     ///< Set by the application when this frame differs from the last
+    bool _idle_enabled;      ///< True if the idle policy is active
+    int _idle_wait_ms;       ///< Loop period while idle (ms)
+    int _idle_after_frames;  ///< Unchanged frames before the loop goes idle
+    int _unchanged_frames;   ///< Consecutive frames without _frame_changed
+    cv::Point _last_mouse;   ///< Mouse position seen on the previous frame
+
+    /// @brief True while the loop is backed off to the idle refresh rate.
+    bool is_idle() const { return _idle_enabled && _unchanged_frames >= _idle_after_frames; }
+
+    std::vector<int> _latch_channels; ///< Analog channels the application late-latches
+    bool _late_latch;        ///< True if latch_analog re-reads from the poll snapshot
+    int _hud_latch;          ///< HUD series: input age saved by latching (-1 until enabled)
+
+    /**
+     * @brief Re-reads an analog channel just before a latency-critical use.
+     *
+     * If late latching is enabled and the background snapshot holds a newer
+     * sample than the one read in gpio(), percent is replaced by it.
+     * Otherwise percent is left unchanged.
+     *
+     * @param channel Analog channel listed in _latch_channels
+     * @param percent Value read in gpio(), updated in place
+     * @return true if a newer sample was latched
+     */
+    bool latch_analog(int channel, double& percent);
+
+    InputTag _frame_input;              ///< Oldest input sample reflected in this frame
+    unsigned int _last_traced_id;       ///< Sample id of the last recorded latency
+    CRingBuffer<double> _input_latency; ///< Input-to-present latency history (ms)
+    int _hud_input;                     ///< HUD series: input-to-present latency
+
+    /**
+     * @brief Marks the frame being built as a reaction to an input sample.
+     *
+     * The oldest tag passed in during a frame is kept. When the frame is
+     * presented its input-to-display latency is recorded once per sample.
+     * Nothing is traced while replaying an input log.
+     *
+     * @param tag Tag returned by CControl::get_input_tag
+     */
+    void tag_frame(const InputTag& tag);
+
+    /**
+     * @brief Prints the input-to-display latency distribution to the console.
+     */
+    void report_input_latency();
+
+    static CInputLog::Mode _input_log_mode; ///< Log mode applied to new applications
+    static std::string _input_log_path;     ///< Log file applied to new applications
+
+    /**
+     * @brief Shows the back buffer in _window_name and flips the swap chain.
+     *
+     * Draws the performance overlay on top of the frame when it is enabled,
+     * updates cvui and hands the buffer to cv::imshow. The latency of any
+     * input tagged for this frame is recorded once imshow returns. The flip
+     * only swaps which buffer _canvas refers to; no pixels are copied.
+     * Called by run() after draw(); derived classes never call cv::imshow.
+     */
+    void present();
+
 public:
     /**
      * @brief Constructs the base class.
@@ -36,7 +312,7 @@ public:
     /**
      * @brief Virtual destructor.
      */
-    ~CBase4618();
+    virtual ~CBase4618();
 
 
     /**
@@ -70,11 +346,76 @@ public:
      */
     virtual void draw() = 0;
 
+    /**
+     * @brief Selects input recording or replay for applications created afterwards.
+     *
+     * The log has to be opened before the derived constructor runs, because
+     * constructors may already consume random numbers (e.g. the first Pong serve).
+     *
+     * @param mode CInputLog::RECORD, CInputLog::REPLAY or CInputLog::OFF
+     * @param path Log file to write or read
+     */
+    static void set_input_log(CInputLog::Mode mode, const std::string& path);
+
+    /**
+     * @brief Selects the GDI DIB section presenter for applications created afterwards.
+     *
+     * Falls back to cv::imshow if the presenter cannot be opened (not
+     * Windows, or the window or DIB section cannot be created).
+     *
+     * @param enable True to present through GDI
+     */
+    static void set_gdi_present(bool enable);
+
+    /**
+     * @brief Selects the 8-bit indexed world for applications created afterwards.
+     *
+     * Applications that do not support it keep drawing in BGR.
+     *
+     * @param enable True to draw the world as palette indices
+     */
+    static void set_indexed_mode(bool enable);
+
+    /**
+     * @brief Configures the idle refresh policy.
+     *
+     * @param enable True to back off when nothing changes
+     * @param idle_wait_ms Loop period while idle in milliseconds
+     * @param idle_after_frames Unchanged frames before the loop goes idle
+     */
+    void set_idle_policy(bool enable, int idle_wait_ms = 100, int idle_after_frames = 30);
+
+    /**
+     * @brief Enables or disables late-latched analog input.
+     *
+     * Starts or stops the CControl poll thread for _latch_channels.
+     *
+     * @param enable True to latch inputs right before use
+     */
+    void set_late_latch(bool enable);
+
+    /**
+     * @brief Enables or disables dynamic resolution for the world target.
+     *
+     * Ignored by applications that do not draw into _world.
+     *
+     * @param enable True to scale the world target to the budget
+     * @param budget_ms Target draw + present time in milliseconds
+     */
+    void set_dynamic_resolution(bool enable, double budget_ms = 16.7);
+
+    /// @brief Current world render scale (1 = native).
+    double get_render_scale() const { return _render_scale; }
+
     /**
      * @brief Runs the main application loop.
      *
-     * Calls update and draw repeatedly until the user presses 'q'.
+     * Calls update, draw and present repeatedly until the user presses 'q'.
      * This is the only location where cv::waitKey is used.
+     * Each phase is timed and recorded in the performance overlay.
+     * When replaying, the loop ends at the end of the input log.
+     * While idle, gpio and update keep running at the idle rate and draw is
+     * skipped unless the frame changed.
      */
     void run();
 };
\ No newline at end of file
@@ -4,9 +4,10 @@
 #include <string>
 #include <sstream>
 #include <opencv2/core.hpp>
+#include <chrono>
 
 CControl::CControl() {}
-CControl::~CControl() {}
+CControl::~CControl() { stop_polling(); }
 
 /////////////
 // constants
@@ -54,6 +55,8 @@ static bool read_line(Serial& serial_port, std::string& out_line, double timeout
 
 void CControl::init_com(int comport)
 {
+    std::lock_guard<std::mutex> lock(_com_mutex);
+
     std::string port_name = "COM" + std::to_string(comport);
 
     _com.open(port_name.c_str()); // open expects const char*
@@ -70,6 +73,31 @@ void CControl::init_com(int comport)
 
 bool CControl::get_data(int type, int channel, int& result)
 {
+    bool ok = false;
+
+    if (_input_log != nullptr && _input_log->is_replaying())
+    {
+        ok = _input_log->replay(result);
+        _connected = ok;
+    }
+    else
+    {
+        ok = read_data(type, channel, result);
+
+        if (_input_log != nullptr && _input_log->is_recording())
+            _input_log->record(result, ok);
+    }
+
+    if (ok)
+        _input_tags[std::make_pair(type, channel)] = new_tag();
+
+    return ok;
+}
+
+bool CControl::read_data(int type, int channel, int& result)
+{
+    std::lock_guard<std::mutex> lock(_com_mutex);
+
     // Build "G type channel\n"
     std::stringstream tx_builder;
     tx_builder << "G " << type << " " << channel << newline_char;
@@ -128,6 +156,8 @@ bool CControl::get_data(int type, int channel, int& result)
 
 bool CControl::set_data(int type, int channel, int val)
 {
+    std::lock_guard<std::mutex> lock(_com_mutex);
+
     // Build "S type channel value\n"
     std::stringstream tx_builder;
     tx_builder << "S " << type << " " << channel << " " << val << newline_char;
@@ -187,9 +217,34 @@ bool CControl::get_analog_percent(int channel, double& percent)
 }
 
 bool CControl::get_button_debounced(int channel, double debounce_time)
+{
+    bool pressed = false;
+
+    // Debounce depends on wall-clock time, so the final press event is logged
+    if (_input_log != nullptr && _input_log->is_replaying())
+    {
+        int logged = 0;
+        _input_log->replay(logged);
+        pressed = (logged != 0);
+    }
+    else
+    {
+        pressed = read_button_debounced(channel, debounce_time);
+
+        if (_input_log != nullptr && _input_log->is_recording())
+            _input_log->record(pressed ? 1 : 0, true);
+    }
+
+    if (pressed)
+        _input_tags[std::make_pair((int)DIGITAL, channel)] = new_tag();
+
+    return pressed;
+}
+
+bool CControl::read_button_debounced(int channel, double debounce_time)
 {
     int button_val = 1;
-    if (!get_data(DIGITAL, channel, button_val))
+    if (!read_data(DIGITAL, channel, button_val))
         return false;
 
     double now = cv::getTickCount() / cv::getTickFrequency();
@@ -238,4 +293,102 @@ bool CControl::get_accel(double& ax, double& ay, double& az)
     ay = (y_pct - 50.0) / 50.0;
     az = (z_pct - 50.0) / 50.0;
     return true;
+}
+
+void CControl::start_polling(const std::vector<int>& channels)
+{
+    stop_polling();
+
+    // Replayed inputs come from the log, not the serial port
+    if (_input_log != nullptr && _input_log->is_replaying())
+        return;
+
+    _poll_channels = channels;
+    _polling = true;
+    _poll_thread = std::thread(&CControl::poll_loop, this);
+}
+
+void CControl::stop_polling()
+{
+    _polling = false;
+
+    if (_poll_thread.joinable())
+        _poll_thread.join();
+}
+
+void CControl::poll_loop()
+{
+    while (_polling)
+    {
+        for (int channel : _poll_channels)
+        {
+            int raw = 0;
+            if (!read_data(ANALOG, channel, raw))
+                continue;
+
+            CachedSample sample = { raw, new_tag() };
+
+            std::lock_guard<std::mutex> lock(_snapshot_mutex);
+            _snapshot[channel] = sample;
+        }
+
+        // Leave a gap so gpio() can get at the serial port
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+bool CControl::get_analog_cached(int channel, double& percent, InputTag& tag)
+{
+    int raw = 0;
+    bool ok = false;
+
+    if (_input_log != nullptr && _input_log->is_replaying())
+    {
+        ok = _input_log->replay(raw);
+        tag = new_tag();
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(_snapshot_mutex);
+
+            auto it = _snapshot.find(channel);
+            if (it != _snapshot.end())
+            {
+                raw = it->second.value;
+                tag = it->second.tag;
+                ok = true;
+            }
+        }
+
+        // A sample no newer than the one gpio() already has is not used. The
+        // outcome is what gets recorded, so a replay latches the same frames.
+        if (ok && tag.time <= get_input_tag(ANALOG, channel).time)
+            ok = false;
+
+        if (_input_log != nullptr && _input_log->is_recording())
+            _input_log->record(raw, ok);
+    }
+
+    if (!ok)
+        return false;
+
+    percent = (raw / ADC_MAX) * 100.0;
+    _input_tags[std::make_pair((int)ANALOG, channel)] = tag;
+
+    return true;
+}
+
+InputTag CControl::get_input_tag(int type, int channel)
+{
+    InputTag none = { 0, 0.0 };
+
+    auto it = _input_tags.find(std::make_pair(type, channel));
+    return (it != _input_tags.end()) ? it->second : none;
+}
+
+InputTag CControl::new_tag()
+{
+    InputTag tag = { ++_next_tag_id, cv::getTickCount() / cv::getTickFrequency() };
+    return tag;
 }
\ No newline at end of file
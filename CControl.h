@@ -1,6 +1,11 @@
 #pragma once
 #include "Serial.h"
+#include "CInputLog.h"
 #include <map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 /**
  * @file CControl.h
@@ -30,6 +35,19 @@ enum ControlType
 	SERVO = 2  /**< Servo output */
 };
 
+/**
+ * @struct InputTag
+ * @brief Identifies one input sample and the time it arrived.
+ *
+ * Tags are carried from CControl through update() and draw() so the
+ * input-to-display latency of each frame can be measured.
+ */
+struct InputTag
+{
+	unsigned int id; /**< Sample sequence number, 0 means no sample */
+	double time;     /**< Arrival time in seconds (cv::getTickCount based) */
+};
+
 /**
  * @class CControl
  * @brief Implements GET/SET communication with the embedded system over a serial COM port.
@@ -46,7 +64,47 @@ private:
 	std::map<int, double> _press_start;    ///< Per-channel debounce start time
 	std::map<int, double> _counted_time;   ///< Per-channel debounce latch time
 
-	bool _connected = true; ///< Flag for checking if micro is connected
+	std::atomic<bool> _connected{ true }; ///< Flag for checking if micro is connected
+
+	CInputLog* _input_log = nullptr; ///< Optional input recorder / replayer
+
+	/**
+	 * @brief Most recent value of a background-polled channel.
+	 */
+	struct CachedSample
+	{
+		int value;    ///< Raw ADC value
+		InputTag tag; ///< Sample id and arrival time
+	};
+
+	std::mutex _com_mutex;                  ///< Serialises transactions on _com
+	std::mutex _snapshot_mutex;             ///< Guards _snapshot
+	std::map<int, CachedSample> _snapshot;  ///< Latest polled value per analog channel
+	std::map<std::pair<int, int>, InputTag> _input_tags; ///< Tag of the newest sample handed out per (type, channel)
+	std::atomic<unsigned int> _next_tag_id{ 0 }; ///< Last sample id handed out
+	std::vector<int> _poll_channels;        ///< Analog channels read by the poll thread
+	std::thread _poll_thread;               ///< Background poll thread
+	std::atomic<bool> _polling{ false };    ///< True while the poll thread runs
+
+	/** @brief Poll thread body: keeps _snapshot current. */
+	void poll_loop();
+
+	/** @brief Creates a tag for a sample arriving now. */
+	InputTag new_tag();
+
+	/**
+	 * @brief Performs a GET transaction on the serial port.
+	 *
+	 * This is the unlogged implementation behind get_data.
+	 */
+	bool read_data(int type, int channel, int& result);
+
+	/**
+	 * @brief Runs the debounce state machine on a live digital read.
+	 *
+	 * This is the unlogged implementation behind get_button_debounced.
+	 */
+	bool read_button_debounced(int channel, double debounce_time);
 
 public:
 	
@@ -86,6 +144,63 @@ public:
 	 */
 	void init_com(int comport);
 
+	/**
+	 * @brief Attaches an input log used to record or replay all reads.
+	 *
+	 * While the log is recording, every value returned by get_data and
+	 * get_button_debounced is stored. While it is replaying, those calls
+	 * return the stored values and do not touch the serial port.
+	 *
+	 * @param log Input log, or nullptr to read live inputs only
+	 */
+	void set_input_log(CInputLog* log) { _input_log = log; }
+
+	/**
+	 * @brief Starts a background thread that keeps reading analog channels.
+	 *
+	 * The latest value of each channel is kept in a snapshot that
+	 * get_analog_cached reads without waiting on the serial port.
+	 * Does nothing while replaying an input log.
+	 *
+	 * @param channels Analog channels to poll
+	 */
+	void start_polling(const std::vector<int>& channels);
+
+	/**
+	 * @brief Stops the background poll thread.
+	 */
+	void stop_polling();
+
+	/// @brief True while the background poll thread runs.
+	bool is_polling() const { return _polling; }
+
+	/**
+	 * @brief Reads an analog channel from the background snapshot without blocking.
+	 *
+	 * Recorded and replayed like get_data. A sample that is no newer than
+	 * the last one handed out for the channel is recorded as a failed read,
+	 * so a replay makes the same decision without comparing arrival times.
+	 *
+	 * @param channel Analog channel started with start_polling
+	 * @param percent Receives the value as a percentage (0.0 to 100.0)
+	 * @param tag Receives the id and arrival time of the sample
+	 * @return true if a newer sample is available for the channel
+	 */
+	bool get_analog_cached(int channel, double& percent, InputTag& tag);
+
+	/**
+	 * @brief Returns the tag of the newest sample handed out for a channel.
+	 *
+	 * Updated by get_data, by get_button_debounced (as DIGITAL) when it
+	 * reports a press, and by get_analog_cached (as ANALOG) when the cached
+	 * sample is newer. Channel numbers are per type, so both are needed.
+	 *
+	 * @param type I/O type (DIGITAL, ANALOG, SERVO)
+	 * @param channel Channel index
+	 * @return Sample tag, or id 0 if the channel has not been read
+	 */
+	InputTag get_input_tag(int type, int channel);
+
 	/**
 	 * @brief Sends a GET command and returns the value from the embedded system.
 	 *
@@ -0,0 +1,180 @@
+#include "stdafx.h"
+#include "CDrawList.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cstdlib>
+
+#define DRAW_RESERVE 4096   // commands reserved up front
+
+CDrawList::CDrawList(int tile_size)
+{
+    _tile_size = tile_size > 0 ? tile_size : 128;
+    _text_count = 0;
+    _scale = 1.0;
+
+    _commands.reserve(DRAW_RESERVE);
+}
+
+void CDrawList::clear()
+{
+    _commands.clear();
+    _text_count = 0;
+}
+
+CDrawList::Command& CDrawList::add(Type type, const cv::Scalar& color, int thickness)
+{
+    _commands.push_back(Command());
+
+    Command& cmd = _commands.back();
+    cmd.type = type;
+    cmd.color = color;
+    cmd.thickness = thickness;
+    cmd.radius = 0;
+    cmd.scale = 1.0;
+    cmd.text = -1;
+    return cmd;
+}
+
+void CDrawList::circle(cv::Point center, int radius, const cv::Scalar& color, int thickness)
+{
+    Command& cmd = add(CIRCLE, color, thickness);
+    cmd.p0 = center;
+    cmd.radius = radius;
+
+    // Built here so the tile workers never modify the cache
+    _sprites.prepare_circle(radius, color, thickness);
+
+    int r = radius + std::max(thickness, 0) + 1;
+    cmd.bounds = cv::Rect(center.x - r, center.y - r, 2 * r + 1, 2 * r + 1);
+}
+
+void CDrawList::line(cv::Point p0, cv::Point p1, const cv::Scalar& color, int thickness)
+{
+    Command& cmd = add(LINE, color, thickness);
+    cmd.p0 = p0;
+    cmd.p1 = p1;
+
+    int pad = std::max(thickness, 1) + 1;
+    cmd.bounds = cv::Rect(std::min(p0.x, p1.x) - pad, std::min(p0.y, p1.y) - pad,
+        std::abs(p1.x - p0.x) + 2 * pad + 1, std::abs(p1.y - p0.y) + 2 * pad + 1);
+}
+
+void CDrawList::rect(const cv::Rect& r, const cv::Scalar& color, int thickness)
+{
+    Command& cmd = add(RECT, color, thickness);
+    cmd.p0 = r.tl();
+    cmd.p1 = r.br() - cv::Point(1, 1);
+
+    int pad = std::max(thickness, 1) + 1;
+    cmd.bounds = cv::Rect(r.x - pad, r.y - pad, r.width + 2 * pad, r.height + 2 * pad);
+}
+
+void CDrawList::text(const std::string& str, cv::Point org, double scale, const cv::Scalar& color, int thickness)
+{
+    // Reuse the string storage of earlier frames
+    if (_text_count == _text.size())
+        _text.push_back(str);
+    else
+        _text[_text_count] = str;
+
+    Command& cmd = add(TEXT, color, thickness);
+    cmd.p0 = org;
+    cmd.scale = scale;
+    cmd.text = (int)_text_count++;
+
+    // Brackets and accents reach above the reported text height
+    int baseline = 0;
+    cv::Size size = cv::getTextSize(str, cv::FONT_HERSHEY_SIMPLEX, scale, thickness, &baseline);
+    int pad = thickness + 2;
+    cmd.bounds = cv::Rect(org.x - pad, org.y - size.height - size.height / 2 - pad,
+        size.width + 2 * pad, size.height + size.height / 2 + baseline + 2 * pad);
+}
+
+void CDrawList::draw_command(cv::Mat& tile, cv::Point offset, const Command& cmd) const
+{
+    cv::Point p0 = scaled(cmd.p0) - offset;
+    cv::Point p1 = scaled(cmd.p1) - offset;
+    int thickness = scaled(cmd.thickness);
+
+    switch (cmd.type)
+    {
+    case CIRCLE:
+        if (!_sprites.stamp_prepared(tile, p0, scaled(cmd.radius), cmd.color, thickness))
+            cv::circle(tile, p0, scaled(cmd.radius), cmd.color, thickness);
+        break;
+    case LINE:
+        cv::line(tile, p0, p1, cmd.color, thickness);
+        break;
+    case RECT:
+        cv::rectangle(tile, p0, p1, cmd.color, thickness);
+        break;
+    case TEXT:
+        cv::putText(tile, _text[cmd.text], p0, cv::FONT_HERSHEY_SIMPLEX,
+            cmd.scale * _scale, cmd.color, thickness);
+        break;
+    }
+}
+
+void CDrawList::render(cv::Mat& im, double scale)
+{
+    if (_commands.empty() || im.empty())
+        return;
+
+    _scale = scale > 0.0 ? scale : 1.0;
+
+    // Scaled circles are new sprite variants; build them before the workers start
+    if (_scale != 1.0)
+    {
+        for (const Command& cmd : _commands)
+        {
+            if (cmd.type == CIRCLE)
+                _sprites.prepare_circle(scaled(cmd.radius), cmd.color, scaled(cmd.thickness));
+        }
+    }
+
+    int tiles_x = (im.cols + _tile_size - 1) / _tile_size;
+    int tiles_y = (im.rows + _tile_size - 1) / _tile_size;
+    int tile_count = tiles_x * tiles_y;
+
+    if ((int)_bins.size() < tile_count)
+        _bins.resize(tile_count);
+    for (int t = 0; t < tile_count; t++)
+        _bins[t].clear();
+
+    cv::Rect canvas(0, 0, im.cols, im.rows);
+
+    // Bin in submission order so each tile keeps the painter's order
+    for (int i = 0; i < (int)_commands.size(); i++)
+    {
+        const cv::Rect& c = _commands[i].bounds;
+        cv::Rect b = cv::Rect(scaled(c.tl()), scaled(c.br()) + cv::Point(1, 1)) & canvas;
+        if (b.empty())
+            continue;
+
+        int tx0 = b.x / _tile_size;
+        int tx1 = (b.x + b.width - 1) / _tile_size;
+        int ty0 = b.y / _tile_size;
+        int ty1 = (b.y + b.height - 1) / _tile_size;
+
+        for (int ty = ty0; ty <= ty1; ty++)
+            for (int tx = tx0; tx <= tx1; tx++)
+                _bins[ty * tiles_x + tx].push_back(i);
+    }
+
+    // Tiles do not overlap, so they can be drawn on any thread in any order
+    cv::parallel_for_(cv::Range(0, tile_count), [&](const cv::Range& range)
+    {
+        for (int t = range.start; t < range.end; t++)
+        {
+            if (_bins[t].empty())
+                continue;
+
+            cv::Rect area = cv::Rect((t % tiles_x) * _tile_size, (t / tiles_x) * _tile_size,
+                _tile_size, _tile_size) & canvas;
+            cv::Mat tile = im(area);
+
+            for (int i : _bins[t])
+                draw_command(tile, area.tl(), _commands[i]);
+        }
+    });
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "CSpriteCache.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/**
+ * @file CDrawList.h
+ * @brief Retained per-frame draw commands rendered in parallel screen tiles.
+ */
+
+ /**
+  * @class CDrawList
+  * @brief Collects a frame's primitives and rasterizes them tile by tile across cores.
+  *
+  * Games submit circles, lines, rectangles and text during draw() instead of
+  * calling cv:: drawing functions directly. render() bins every command into
+  * the fixed-size screen tiles its bounding box touches, then rasterizes the
+  * tiles in parallel with cv::parallel_for_. Each tile is drawn through its
+  * own ROI in submission order, so overlapping primitives keep their order
+  * and no two threads ever write the same pixel.
+  *
+  * Circles are stamped from a sprite cache: each variant is rasterized once
+  * on the submitting thread, and the tile workers only read the cache.
+  * Lines clipped at a tile edge may differ from a single cv::line by one
+  * pixel along the edge.
+  *
+  * Command and bin storage is kept between frames; after the first few
+  * frames submitting and rendering does not allocate.
+  */
+class CDrawList
+{
+private:
+    /**
+     * @enum Type
+     * @brief Primitive kind of a command.
+     */
+    enum Type
+    {
+        CIRCLE = 0, /**< cv::circle */
+        LINE = 1,   /**< cv::line */
+        RECT = 2,   /**< cv::rectangle */
+        TEXT = 3    /**< cv::putText */
+    };
+
+    /**
+     * @brief One submitted primitive.
+     */
+    struct Command
+    {
+        Type type;          ///< Primitive kind
+        cv::Point p0;       ///< Centre, start point, top left or text origin
+        cv::Point p1;       ///< End point or bottom right
+        int radius;         ///< Circle radius
+        int thickness;      ///< Stroke thickness, -1 to fill
+        double scale;       ///< Text scale
+        int text;           ///< Index into _text
+        cv::Scalar color;   ///< Colour
+        cv::Rect bounds;    ///< Pixels the primitive may touch
+    };
+
+    std::vector<Command> _commands;       ///< Commands in submission order
+    std::vector<std::string> _text;       ///< Text storage, reused between frames
+    size_t _text_count;                   ///< Strings used this frame
+    std::vector<std::vector<int>> _bins;  ///< Command indices per tile
+    int _tile_size;                       ///< Tile edge length in pixels
+    double _scale;                        ///< Coordinate scale of the current render()
+    CSpriteCache _sprites;                ///< Circle sprites, built at submit time
+
+    /** @brief Appends a command and returns it for the caller to fill. */
+    Command& add(Type type, const cv::Scalar& color, int thickness);
+
+    /**
+     * @brief Draws one command into a tile.
+     *
+     * @param tile Tile ROI of the canvas
+     * @param offset Canvas position of the tile's top left corner
+     * @param cmd Command to draw
+     */
+    void draw_command(cv::Mat& tile, cv::Point offset, const Command& cmd) const;
+
+    /** @brief Applies the render scale to a coordinate. */
+    cv::Point scaled(cv::Point p) const { return cv::Point(cvRound(p.x * _scale), cvRound(p.y * _scale)); }
+
+    /** @brief Applies the render scale to a length, keeping fills (-1) and at least one pixel. */
+    int scaled(int v) const { return v < 0 ? v : std::max(1, cvRound(v * _scale)); }
+
+public:
+    /**
+     * @brief Constructs an empty draw list.
+     *
+     * @param tile_size Tile edge length in pixels
+     */
+    CDrawList(int tile_size = 128);
+
+    /** @brief Discards all commands, keeping their storage. */
+    void clear();
+
+    /// @brief Number of commands submitted this frame.
+    size_t size() const { return _commands.size(); }
+
+    /// @brief Submits a circle. See cv::circle.
+    void circle(cv::Point center, int radius, const cv::Scalar& color, int thickness = 1);
+
+    /// @brief Submits a line. See cv::line.
+    void line(cv::Point p0, cv::Point p1, const cv::Scalar& color, int thickness = 1);
+
+    /// @brief Submits a rectangle. See cv::rectangle.
+    void rect(const cv::Rect& r, const cv::Scalar& color, int thickness = 1);
+
+    /// @brief Submits a line of Hershey simplex text. See cv::putText.
+    void text(const std::string& str, cv::Point org, double scale, const cv::Scalar& color, int thickness = 1);
+
+    /**
+     * @brief Rasterizes all submitted commands.
+     *
+     * The command list is left intact; call clear() before the next frame.
+     *
+     * @param im Canvas to draw on
+     * @param scale Factor applied to all coordinates and sizes, for reduced-resolution targets
+     */
+    void render(cv::Mat& im, double scale = 1.0);
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include "CGameObject.h"
+#include <vector>
+
+/**
+ * @file CEntity.h
+ * @brief Compile-time dispatch of game object update and draw.
+ */
+
+ /**
+  * @class CEntity
+  * @brief CRTP base that routes update() and submit() to the derived class.
+  *
+  * A class derives as `class CShip : public CEntity<CShip>` and defines its
+  * own move() and draw(CDrawList&, const Scalar&). update() and submit()
+  * cast to the derived type and call those directly, so the right code runs
+  * regardless of how the object is reached, the calls inline, and no
+  * vtable is involved. update_all() runs one type's update as a single loop
+  * over a contiguous container of that type.
+  *
+  * CShip is the game object the game itself updates this way; CAsteroid
+  * derives the same way and is used by the entity benchmark. Asteroids and
+  * bullets in the game live in CEntityStore instead.
+  *
+  * @tparam Derived The deriving class.
+  */
+template <typename Derived>
+class CEntity : public CGameObject
+{
+protected:
+    /// @brief Only constructed and destroyed as part of Derived.
+    CEntity() {}
+    ~CEntity() {}
+
+    /// @brief This object as its derived type.
+    Derived& derived() { return static_cast<Derived&>(*this); }
+
+public:
+    /**
+     * @brief Advances the object with Derived::move.
+     *
+     * @param dt Time step in seconds.
+     */
+    void update(double dt) { derived().move(dt); }
+
+    /**
+     * @brief Submits the object with Derived::draw.
+     *
+     * @param list Draw list for the current frame.
+     * @param color Colour, or a palette index for an indexed world.
+     */
+    void submit(CDrawList& list, const Scalar& color) { derived().draw(list, color); }
+};
+
+/**
+ * @brief Updates every object of one type in a single loop.
+ *
+ * @param objects Objects to update.
+ * @param dt Time step in seconds.
+ */
+template <typename T>
+void update_all(std::vector<T>& objects, double dt)
+{
+    for (T& obj : objects)
+        obj.update(dt);
+}
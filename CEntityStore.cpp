@@ -0,0 +1,227 @@
+#include "stdafx.h"
+#include "CEntityStore.h"
+#include <algorithm>
+#include <cmath>
+
+// Advances [begin, end) to step and wraps at w x h. The arrays are restrict
+// parameters, so a vectorized loop needs no runtime overlap checks.
+static void catch_up_kernel(int begin, int end, int step, float dt, float w, float h,
+    float* __restrict x, float* __restrict y, float* __restrict prev_x, float* __restrict prev_y,
+    const float* __restrict vx, const float* __restrict vy, int* __restrict stamp)
+{
+    for (int i = begin; i < end; i++)
+    {
+        float t = (float)(step - stamp[i]) * dt;
+        float cx = x[i] + vx[i] * t;
+        float cy = y[i] + vy[i] * t;
+        float wx = cx < 0.0f ? w : (cx > w ? 0.0f : cx);
+        float wy = cy < 0.0f ? h : (cy > h ? 0.0f : cy);
+
+        // One step back from where it is now, on the same side of any wrap
+        prev_x[i] = wx - vx[i] * dt;
+        prev_y[i] = wy - vy[i] * dt;
+        x[i] = wx;
+        y[i] = wy;
+        stamp[i] = step;
+    }
+}
+
+CEntityStore::CEntityStore(size_t capacity)
+{
+    _capacity = capacity > 0 ? capacity : 1;
+    _count = 0;
+    _step = 0;
+    _max_speed = 0.0f;
+    _oldest = 0;
+
+    // Everything is sized once; adding and removing never allocates
+    _x.resize(_capacity);
+    _y.resize(_capacity);
+    _prev_x.resize(_capacity);
+    _prev_y.resize(_capacity);
+    _vx.resize(_capacity);
+    _vy.resize(_capacity);
+    _radius.resize(_capacity);
+    _lives.resize(_capacity);
+    _flag.resize(_capacity);
+    _stamp.resize(_capacity);
+}
+
+void CEntityStore::clear()
+{
+    _count = 0;
+    _max_speed = 0.0f;
+    _oldest = _step;
+}
+
+bool CEntityStore::add(cv::Point2f pos, cv::Point2f vel, float radius, int lives)
+{
+    if (_count == _capacity)
+        return false;
+
+    size_t i = _count++;
+    _x[i] = pos.x;
+    _y[i] = pos.y;
+    _prev_x[i] = pos.x;
+    _prev_y[i] = pos.y;
+    _vx[i] = vel.x;
+    _vy[i] = vel.y;
+    _radius[i] = radius;
+    _lives[i] = lives;
+    _flag[i] = 0;
+    _stamp[i] = _step;
+    _max_speed = std::max(_max_speed, std::abs(vel.x) + std::abs(vel.y));
+    return true;
+}
+
+void CEntityStore::set_vel(size_t i, cv::Point2f vel)
+{
+    _vx[i] = vel.x;
+    _vy[i] = vel.y;
+    _max_speed = std::max(_max_speed, std::abs(vel.x) + std::abs(vel.y));
+}
+
+bool CEntityStore::collide(size_t i, cv::Point2f pos, float radius) const
+{
+    // Compared squared; no square root per pair
+    float dx = _x[i] - pos.x;
+    float dy = _y[i] - pos.y;
+    float reach = _radius[i] + radius;
+    return dx * dx + dy * dy < reach * reach;
+}
+
+void CEntityStore::save_previous(cv::Range r)
+{
+    std::copy(_x.begin() + r.start, _x.begin() + r.end, _prev_x.begin() + r.start);
+    std::copy(_y.begin() + r.start, _y.begin() + r.end, _prev_y.begin() + r.start);
+}
+
+void CEntityStore::move(float dt, cv::Range r)
+{
+    float* __restrict x = _x.data();
+    float* __restrict y = _y.data();
+    const float* __restrict vx = _vx.data();
+    const float* __restrict vy = _vy.data();
+
+    for (int i = r.start; i < r.end; i++)
+    {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+}
+
+void CEntityStore::catch_up(float dt, cv::Size board, cv::Range r)
+{
+    catch_up_kernel(r.start, r.end, _step, dt, (float)board.width, (float)board.height,
+        _x.data(), _y.data(), _prev_x.data(), _prev_y.data(), _vx.data(), _vy.data(), _stamp.data());
+}
+
+void CEntityStore::catch_up(float dt, cv::Size board, const std::vector<int>& items)
+{
+    for (int i : items)
+        catch_up(dt, board, cv::Range(i, i + 1));
+}
+
+float CEntityStore::max_behind(float dt) const
+{
+    return _max_speed * (float)(_step - _oldest) * dt;
+}
+
+void CEntityStore::wrap(cv::Size board, cv::Range r)
+{
+    float w = (float)board.width;
+    float h = (float)board.height;
+    float* __restrict x = _x.data();
+    float* __restrict y = _y.data();
+    float* __restrict prev_x = _prev_x.data();
+    float* __restrict prev_y = _prev_y.data();
+
+    // Selects instead of branches, so each line becomes a compare and blend
+    for (int i = r.start; i < r.end; i++)
+    {
+        float cx = x[i];
+        float cy = y[i];
+        float wx = cx < 0.0f ? w : (cx > w ? 0.0f : cx);
+        float wy = cy < 0.0f ? h : (cy > h ? 0.0f : cy);
+        prev_x[i] += wx - cx;
+        prev_y[i] += wy - cy;
+        x[i] = wx;
+        y[i] = wy;
+    }
+}
+
+void CEntityStore::mark_off_screen(cv::Size board, cv::Range r)
+{
+    float w = (float)board.width;
+    float h = (float)board.height;
+    const float* __restrict x = _x.data();
+    const float* __restrict y = _y.data();
+    uint8_t* __restrict flag = _flag.data();
+
+    for (int i = r.start; i < r.end; i++)
+        flag[i] |= (uint8_t)((x[i] < 0.0f) | (x[i] > w) | (y[i] < 0.0f) | (y[i] > h));
+}
+
+void CEntityStore::release(size_t i)
+{
+    size_t last = --_count;
+    if (i != last)
+    {
+        _x[i] = _x[last];
+        _y[i] = _y[last];
+        _prev_x[i] = _prev_x[last];
+        _prev_y[i] = _prev_y[last];
+        _vx[i] = _vx[last];
+        _vy[i] = _vy[last];
+        _radius[i] = _radius[last];
+        _lives[i] = _lives[last];
+        _flag[i] = _flag[last];
+        _stamp[i] = _stamp[last];
+    }
+}
+
+void CEntityStore::flush()
+{
+    // The max_behind() bound is rebuilt from the entities that are kept
+    float max_speed = 0.0f;
+    int oldest = _step;
+
+    // Walking down means the entity moved into a hole has already been kept
+    for (size_t i = _count; i > 0; i--)
+    {
+        if (_flag[i - 1] || _lives[i - 1] <= 0)
+        {
+            release(i - 1);
+        }
+        else
+        {
+            max_speed = std::max(max_speed, std::abs(_vx[i - 1]) + std::abs(_vy[i - 1]));
+            oldest = std::min(oldest, _stamp[i - 1]);
+        }
+    }
+
+    _max_speed = max_speed;
+    _oldest = oldest;
+}
+
+void CEntityStore::draw_one(CDrawList& list, size_t i, const cv::Scalar& color, int thickness, float alpha, cv::Point2f offset) const
+{
+    if (_flag[i] || _lives[i] <= 0)
+        return;
+
+    float x = _prev_x[i] + (_x[i] - _prev_x[i]) * alpha + offset.x;
+    float y = _prev_y[i] + (_y[i] - _prev_y[i]) * alpha + offset.y;
+    list.circle(cv::Point(cvRound(x), cvRound(y)), (int)_radius[i], color, thickness);
+}
+
+void CEntityStore::draw(CDrawList& list, const cv::Scalar& color, int thickness, float alpha, cv::Point2f offset) const
+{
+    for (size_t i = 0; i < _count; i++)
+        draw_one(list, i, color, thickness, alpha, offset);
+}
+
+void CEntityStore::draw(CDrawList& list, const std::vector<int>& items, const cv::Scalar& color, int thickness, float alpha, cv::Point2f offset) const
+{
+    for (int i : items)
+        draw_one(list, i, color, thickness, alpha, offset);
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "CAlignedAllocator.h"
+#include "CDrawList.h"
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file CEntityStore.h
+ * @brief Fixed-capacity structure-of-arrays pool for one entity kind.
+ */
+
+ /**
+  * @class CEntityStore
+  * @brief Keeps the state of many simple entities in separate arrays.
+  *
+  * Asteroids and bullets only need a position, velocity, radius and life
+  * count. Instead of one object per entity with its fields interleaved,
+  * each field is kept in its own contiguous array, and the per-frame
+  * operations (move, wrap, off-screen test) run as loops over whole
+  * arrays. The loops have no branches or calls in their bodies, so they are
+  * written to be vectorizable, and each kernel touches only the arrays it
+  * needs. The arrays come from CAlignedAllocator, so each one starts on a
+  * SIMD boundary. GCC -O2 -ftree-vectorize vectorizes move(), catch_up(),
+  * wrap() and mark_off_screen(); /Qvec-report:2 shows what MSVC does.
+  *
+  * All storage is allocated for a fixed capacity at construction. Live
+  * entities are packed at the front of the arrays, so kernels and index
+  * loops run over [0, size()). Entities are only referred to by index,
+  * within a frame; nothing keeps a reference to one across frames.
+  *
+  * Destruction is deferred: hits and off-screen tests only mark entities,
+  * and flush() reclaims every marked or dead entity at once, moving the
+  * last live entity into each hole. Dense indices are therefore only valid
+  * until the next flush().
+  *
+  * The kernels also take an index range, so disjoint ranges can be run on
+  * several threads at once (see parallel_chunks()).
+  *
+  * For simulation level of detail, each entity also records the step its
+  * position was last advanced to. tick() starts a step, and catch_up()
+  * advances entities by however many steps they are behind, so entities
+  * far from the view can be updated every few steps, in slices, and still
+  * end up where updating them every step would have put them. The
+  * exception is an entity that crossed the board edge while behind:
+  * catch_up() wraps it once, to the opposite edge as wrap() does, and the
+  * distance it travelled past the edge is lost, so callers must not rely
+  * on where such an entity lands.
+  */
+class CEntityStore
+{
+private:
+    CAlignedVector<float> _x;       ///< Position x
+    CAlignedVector<float> _y;       ///< Position y
+    CAlignedVector<float> _prev_x;  ///< Position x before the last simulation step
+    CAlignedVector<float> _prev_y;  ///< Position y before the last simulation step
+    CAlignedVector<float> _vx;      ///< Velocity x (pixels per second)
+    CAlignedVector<float> _vy;      ///< Velocity y (pixels per second)
+    CAlignedVector<float> _radius;  ///< Collision radius
+    CAlignedVector<int> _lives;     ///< Remaining lives
+    CAlignedVector<uint8_t> _flag;  ///< Marked for destruction at the next flush()
+    CAlignedVector<int> _stamp;     ///< Step each position was last advanced to (catch_up())
+
+    size_t _count;                  ///< Live entities
+    size_t _capacity;               ///< Entities the arrays hold
+    int _step;                      ///< Current step for catch_up(); new entities start at it
+    float _max_speed;               ///< At least |vx| + |vy| of every live entity (max_behind())
+    int _oldest;                    ///< No live entity was last advanced before this step (max_behind())
+
+    /** @brief Destroys dense entity i by moving the last live entity into it. */
+    void release(size_t i);
+
+    /** @brief Submits entity i, blended and offset, unless it is waiting for flush(). */
+    void draw_one(CDrawList& list, size_t i, const cv::Scalar& color, int thickness, float alpha, cv::Point2f offset) const;
+
+public:
+    /**
+     * @brief Constructs an empty pool.
+     *
+     * @param capacity Maximum number of live entities
+     */
+    CEntityStore(size_t capacity = 256);
+
+    /// @brief Number of live entities.
+    size_t size() const { return _count; }
+
+    /// @brief Maximum number of live entities.
+    size_t capacity() const { return _capacity; }
+
+    /** @brief Destroys all entities. */
+    void clear();
+
+    /**
+     * @brief Adds an entity.
+     *
+     * @param pos Position
+     * @param vel Velocity in pixels per second
+     * @param radius Collision radius
+     * @param lives Life count
+     * @return false if the pool is full and the entity was not added
+     */
+    bool add(cv::Point2f pos, cv::Point2f vel, float radius, int lives = 1);
+
+    /// @brief Position of entity i.
+    cv::Point2f get_pos(size_t i) const { return cv::Point2f(_x[i], _y[i]); }
+
+    /// @brief Velocity of entity i.
+    cv::Point2f get_vel(size_t i) const { return cv::Point2f(_vx[i], _vy[i]); }
+
+    /// @brief Sets the velocity of entity i.
+    void set_vel(size_t i, cv::Point2f vel);
+
+    /// @brief Collision radius of entity i.
+    float get_radius(size_t i) const { return _radius[i]; }
+
+    /// @brief Remaining lives of entity i.
+    int get_lives(size_t i) const { return _lives[i]; }
+
+    /// @brief Takes one life from entity i; it is reclaimed by the next flush() when none are left.
+    void hit(size_t i) { _lives[i]--; }
+
+    /**
+     * @brief Tests entity i against a circle.
+     *
+     * @param i Entity index
+     * @param pos Circle centre
+     * @param radius Circle radius
+     * @return true if the circles overlap
+     */
+    bool collide(size_t i, cv::Point2f pos, float radius) const;
+
+    /**
+     * @brief Keeps the current positions as the previous step's, for draw().
+     *
+     * @param r Entities to save
+     */
+    void save_previous(cv::Range r);
+
+    /// @brief Keeps every current position as the previous step's.
+    void save_previous() { save_previous(cv::Range(0, (int)_count)); }
+
+    /**
+     * @brief Advances positions by their velocity.
+     *
+     * @param dt Time step in seconds
+     * @param r Entities to move
+     */
+    void move(float dt, cv::Range r);
+
+    /// @brief Advances every position by its velocity.
+    void move(float dt) { move(dt, cv::Range(0, (int)_count)); }
+
+    /// @brief Starts a new step; entities not caught up fall one step further behind.
+    void tick() { _step++; }
+
+    /**
+     * @brief Advances entities to the current step and wraps them at the board edges.
+     *
+     * Each entity moves by its velocity times the steps it is behind, and
+     * its previous position is set to where it was one step ago, so draw()
+     * interpolates correctly even for an entity that was behind.
+     *
+     * @param dt Step length in seconds
+     * @param board Board size
+     * @param r Entities to advance
+     */
+    void catch_up(float dt, cv::Size board, cv::Range r);
+
+    /**
+     * @brief Advances a list of entities to the current step.
+     *
+     * @param dt Step length in seconds
+     * @param board Board size
+     * @param items Dense indices, e.g. from CSpatialGrid::query_rect()
+     */
+    void catch_up(float dt, cv::Size board, const std::vector<int>& items);
+
+    /**
+     * @brief Farthest any entity is from where catch_up() would move it.
+     *
+     * A bound, not an exact distance, and constant time: the fastest
+     * speed (x and y added) times the age of the stalest entity. Both are
+     * raised as entities are added or sped up and brought back down by
+     * flush(), which visits every entity anyway. Wrapping is ignored.
+     *
+     * @param dt Step length in seconds
+     * @return Distance in pixels; 0 when every entity is at the current step
+     */
+    float max_behind(float dt) const;
+
+    /**
+     * @brief Moves entities that left the board to the opposite edge.
+     *
+     * The previous position moves with the entity, so an interpolated draw
+     * does not sweep across the board.
+     *
+     * @param board Board size
+     * @param r Entities to wrap
+     */
+    void wrap(cv::Size board, cv::Range r);
+
+    /// @brief Wraps every entity that left the board.
+    void wrap(cv::Size board) { wrap(board, cv::Range(0, (int)_count)); }
+
+    /**
+     * @brief Marks entities whose centre is outside the board for destruction.
+     *
+     * @param board Board size
+     * @param r Entities to test
+     */
+    void mark_off_screen(cv::Size board, cv::Range r);
+
+    /// @brief Marks every entity outside the board for destruction.
+    void mark_off_screen(cv::Size board) { mark_off_screen(board, cv::Range(0, (int)_count)); }
+
+    /** @brief Reclaims every marked entity and every entity with no lives left. */
+    void flush();
+
+    /**
+     * @brief Submits every live entity as a circle outline.
+     *
+     * Entities waiting for flush() are skipped.
+     *
+     * @param list Draw list for the current frame
+     * @param color Outline colour
+     * @param thickness Outline thickness
+     * @param alpha Blend from the previous (0) to the current (1) position
+     * @param offset Added to every position, e.g. minus the camera origin
+     */
+    void draw(CDrawList& list, const cv::Scalar& color, int thickness, float alpha = 1.0f, cv::Point2f offset = cv::Point2f()) const;
+
+    /**
+     * @brief Submits a list of entities as circle outlines.
+     *
+     * @param list Draw list for the current frame
+     * @param items Dense indices to draw, e.g. from CSpatialGrid::query_rect()
+     * @param color Outline colour
+     * @param thickness Outline thickness
+     * @param alpha Blend from the previous (0) to the current (1) position
+     * @param offset Added to every position, e.g. minus the camera origin
+     */
+    void draw(CDrawList& list, const std::vector<int>& items, const cv::Scalar& color, int thickness, float alpha, cv::Point2f offset) const;
+};
@@ -2,6 +2,8 @@
 #include "CGameObject.h"
 #include <cmath>
 
+CSpriteCache CGameObject::_sprites;
+
 CGameObject::CGameObject()
 {
     _position = Point2f(0, 0);
@@ -20,8 +22,9 @@ void CGameObject::move(double dt)
 
 bool CGameObject::collide(CGameObject& obj)
 {
-    float distance = norm(_position - obj._position);
-    return distance < (_radius + obj._radius);
+    Point2f d = _position - obj._position;
+    float reach = (float)(_radius + obj._radius);
+    return d.dot(d) < reach * reach;
 }
 
 bool CGameObject::collide_wall(Size board)
@@ -42,6 +45,11 @@ void CGameObject::hit()
 
 void CGameObject::draw(Mat& im)
 {
-    circle(im, _position, _radius, Scalar(255, 255, 255), 1);
+    _sprites.stamp_circle(im, _position, _radius, Scalar(255, 255, 255), 1);
+}
+
+void CGameObject::draw(CDrawList& list, const Scalar& color)
+{
+    list.circle(_position, _radius, color, 1);
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 #include <opencv2/opencv.hpp>
+#include "CSpriteCache.h"
+#include "CDrawList.h"
 
 using namespace cv;
 
@@ -14,7 +16,11 @@ using namespace cv;
  * Derived classes include:
  * - CShip
  * - CAsteroid
- * - CBullet
+ *
+ * Game objects are not polymorphic. The base move() and draw() are
+ * protected building blocks; derived classes derive through CEntity, which
+ * dispatches update() and submit() to their own versions at compile time,
+ * so calling through a base reference cannot silently run the base code.
  */
 class CGameObject
 {
@@ -28,19 +34,45 @@ protected:
     float _angle;         ///< Orientation angle (radians)
     float _angular_vel;   ///< Angular velocity (optional)
 
-public:
+    static CSpriteCache _sprites; ///< Circle sprites shared by all game objects
 
     /**
      * @brief Construct a game object with default values.
      */
     CGameObject();
 
+    /**
+     * @brief Not deleted through base pointers, so no vtable is needed.
+     */
+    ~CGameObject() {}
+
     /**
      * @brief Update position using time based motion.
      * @param dt Delta time in seconds.
      */
     void move(double dt);
 
+    /**
+     * @brief Draw object on screen.
+     *
+     * Base implementation may draw a simple circle.
+     * Derived classes may override for custom graphics.
+     * Circles are stamped from the shared sprite cache.
+     */
+    void draw(Mat& im);
+
+    /**
+     * @brief Submit object graphics to a frame draw list.
+     *
+     * Same graphics as draw(Mat&), rasterized later by CDrawList::render.
+     *
+     * @param list Draw list for the current frame.
+     * @param color Outline colour, or a palette index for an indexed world.
+     */
+    void draw(CDrawList& list, const Scalar& color = Scalar(255, 255, 255));
+
+public:
+
     /**
      * @brief Check collision with another object.
      * @param obj Other game object.
@@ -99,17 +131,4 @@ public:
     /// @brief Get orientation angle.
     /// @return Current angle in radians.
     float get_angle() { return _angle; }
-
-    /**
-     * @brief Draw object on screen.
-     *
-     * Base implementation may draw a simple circle.
-     * Derived classes may override for custom graphics.
-     */
-    void draw(Mat& im);
-
-    /**
-     * @brief Virtual destructor.
-     */
-    virtual ~CGameObject() {}
 };
\ No newline at end of file
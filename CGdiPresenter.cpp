@@ -0,0 +1,242 @@
+#include "stdafx.h"
+#include "CGdiPresenter.h"
+#include <opencv2/imgproc.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+
+#define GDI_CLASS_NAME "CGdiPresenter"
+
+struct CGdiPresenter::GdiState
+{
+    HWND window;             ///< Presentation window
+    HDC window_dc;           ///< Client area DC, kept for the window's lifetime
+    HDC memory_dc;           ///< DC the DIB section is selected into
+    HBITMAP dib;             ///< DIB section holding the last frame
+    HGDIOBJ old_bitmap;      ///< Bitmap memory_dc held before the DIB section
+    int key;                 ///< Last key pressed, or -1
+};
+
+// Keys are taken from WM_KEYDOWN rather than WM_CHAR, because HighGUI's
+// waitKey() may dispatch this window's messages without translating them
+static LRESULT CALLBACK gdi_window_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
+{
+    CGdiPresenter::GdiState* g = (CGdiPresenter::GdiState*)GetWindowLongPtrA(hwnd, GWLP_USERDATA);
+    if (g == nullptr)
+        return DefWindowProcA(hwnd, msg, wparam, lparam);
+
+    switch (msg)
+    {
+    case WM_KEYDOWN:
+    {
+        int key = (int)wparam;
+        if (key >= 'A' && key <= 'Z')
+            g->key = key - 'A' + 'a';
+        else if ((key >= '0' && key <= '9') || key == VK_ESCAPE || key == VK_SPACE)
+            g->key = key;
+        return 0;
+    }
+
+    case WM_CLOSE:
+        // The application decides when to close; treat it as quit
+        g->key = 'q';
+        return 0;
+
+    case WM_PAINT:
+    {
+        // The DIB section holds the last frame, so exposed areas come from it
+        PAINTSTRUCT ps;
+        HDC dc = BeginPaint(hwnd, &ps);
+        BitBlt(dc, ps.rcPaint.left, ps.rcPaint.top, ps.rcPaint.right - ps.rcPaint.left,
+            ps.rcPaint.bottom - ps.rcPaint.top, g->memory_dc, ps.rcPaint.left, ps.rcPaint.top, SRCCOPY);
+        EndPaint(hwnd, &ps);
+        return 0;
+    }
+    }
+
+    return DefWindowProcA(hwnd, msg, wparam, lparam);
+}
+
+CGdiPresenter::CGdiPresenter()
+{
+    _g = nullptr;
+}
+
+CGdiPresenter::~CGdiPresenter()
+{
+    close();
+}
+
+bool CGdiPresenter::open(const std::string& title, cv::Size size)
+{
+    close();
+
+    HINSTANCE instance = GetModuleHandleA(nullptr);
+
+    // Registered once per process; a second registration fails harmlessly
+    WNDCLASSEXA wc = { 0 };
+    wc.cbSize = sizeof(wc);
+    wc.lpfnWndProc = gdi_window_proc;
+    wc.hInstance = instance;
+    wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
+    wc.lpszClassName = GDI_CLASS_NAME;
+    RegisterClassExA(&wc);
+
+    // Sized so the client area, not the frame, matches the canvas
+    DWORD style = WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX;
+    RECT rect = { 0, 0, size.width, size.height };
+    AdjustWindowRect(&rect, style, FALSE);
+
+    HWND window = CreateWindowExA(0, GDI_CLASS_NAME, title.c_str(), style, CW_USEDEFAULT, CW_USEDEFAULT,
+        rect.right - rect.left, rect.bottom - rect.top, nullptr, nullptr, instance, nullptr);
+    if (window == nullptr)
+        return false;
+
+    // Top-down 32-bit BGRX, the layout GDI blits without conversion
+    BITMAPINFO bmi = { 0 };
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = size.width;
+    bmi.bmiHeader.biHeight = -size.height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    HDC window_dc = GetDC(window);
+    void* bits = nullptr;
+    HBITMAP dib = CreateDIBSection(window_dc, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+    if (dib == nullptr || bits == nullptr)
+    {
+        ReleaseDC(window, window_dc);
+        DestroyWindow(window);
+        return false;
+    }
+
+    GdiState* g = new GdiState();
+    g->window = window;
+    g->window_dc = window_dc;
+    g->memory_dc = CreateCompatibleDC(window_dc);
+    g->dib = dib;
+    g->old_bitmap = SelectObject(g->memory_dc, dib);
+    g->key = -1;
+
+    SetWindowLongPtrA(window, GWLP_USERDATA, (LONG_PTR)g);
+
+    _g = g;
+    _size = size;
+
+    // DIB rows are DWORD aligned, which 4 bytes per pixel always is
+    _dib_mat = cv::Mat(size, CV_8UC4, bits, size.width * 4);
+    _dib_mat.setTo(cv::Scalar::all(0));
+
+    ShowWindow(window, SW_SHOW);
+    UpdateWindow(window);
+    return true;
+}
+
+void CGdiPresenter::close()
+{
+    if (_g == nullptr)
+        return;
+
+    SetWindowLongPtrA(_g->window, GWLP_USERDATA, 0);
+
+    SelectObject(_g->memory_dc, _g->old_bitmap);
+    DeleteDC(_g->memory_dc);
+    DeleteObject(_g->dib);
+    ReleaseDC(_g->window, _g->window_dc);
+    DestroyWindow(_g->window);
+
+    delete _g;
+    _g = nullptr;
+    _dib_mat.release();
+}
+
+void CGdiPresenter::process_messages()
+{
+    MSG msg;
+    while (PeekMessageA(&msg, _g->window, 0, 0, PM_REMOVE))
+    {
+        TranslateMessage(&msg);
+        DispatchMessageA(&msg);
+    }
+}
+
+void CGdiPresenter::present(const cv::Mat& frame, const std::vector<cv::Rect>& damage)
+{
+    if (_g == nullptr || frame.type() != CV_8UC3 || frame.size() != _size)
+        return;
+
+    // GDI batches calls; the previous blits must have read the DIB before it is rewritten
+    GdiFlush();
+
+    cv::Rect full(0, 0, _size.width, _size.height);
+    bool whole = damage.empty();
+    size_t count = whole ? 1 : damage.size();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        cv::Rect r = whole ? full : (damage[i] & full);
+        if (r.empty())
+            continue;
+
+        // Converted straight into the DIB section; the ROI keeps cvtColor from reallocating
+        cv::Mat dst = _dib_mat(r);
+        cv::cvtColor(frame(r), dst, cv::COLOR_BGR2BGRA);
+
+        BitBlt(_g->window_dc, r.x, r.y, r.width, r.height, _g->memory_dc, r.x, r.y, SRCCOPY);
+    }
+
+    GdiFlush();
+    process_messages();
+}
+
+int CGdiPresenter::poll_key()
+{
+    if (_g == nullptr)
+        return -1;
+
+    process_messages();
+
+    int key = _g->key;
+    _g->key = -1;
+    return key;
+}
+
+#else
+
+struct CGdiPresenter::GdiState
+{
+};
+
+CGdiPresenter::CGdiPresenter()
+{
+    _g = nullptr;
+}
+
+CGdiPresenter::~CGdiPresenter()
+{
+}
+
+bool CGdiPresenter::open(const std::string& title, cv::Size size)
+{
+    return false;
+}
+
+void CGdiPresenter::close()
+{
+}
+
+void CGdiPresenter::process_messages()
+{
+}
+
+void CGdiPresenter::present(const cv::Mat& frame, const std::vector<cv::Rect>& damage)
+{
+}
+
+int CGdiPresenter::poll_key()
+{
+    return -1;
+}
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @file CGdiPresenter.h
+ * @brief Optional Win32 presentation through a GDI DIB section.
+ *
+ * Only available on Windows. Elsewhere open() always fails and CBase4618
+ * keeps using cv::imshow.
+ */
+
+ /**
+  * @class CGdiPresenter
+  * @brief Shows BGR frames in a Win32 window backed by a DIB section.
+  *
+  * The window's image is a 32-bit DIB section whose pixels live in memory
+  * the application writes directly. Presenting converts only the damaged
+  * regions of the canvas from BGR to BGRX straight into that memory and
+  * blits the same regions to the window with BitBlt; there is no other
+  * frame copy, and undamaged parts of the window are left alone.
+  *
+  * The DIB section always holds the last frame, so WM_PAINT repaints from
+  * it without asking the application to redraw. The desktop compositor
+  * shows the window, so blits appear at the next refresh without tearing.
+  *
+  * The window handles keys and close requests only. cvui widgets need
+  * HighGUI mouse events, so applications that rely on them should keep the
+  * default cv::imshow path.
+  */
+class CGdiPresenter
+{
+public:
+    struct GdiState;         ///< Win32 handles, defined in the .cpp to keep windows.h out of headers
+
+private:
+    GdiState* _g;            ///< Open window, or nullptr
+    cv::Mat _dib_mat;        ///< DIB section pixels wrapped as CV_8UC4
+    cv::Size _size;          ///< Window client size
+
+    /** @brief Dispatches queued messages for the window (keys, paint, close). */
+    void process_messages();
+
+public:
+    /** @brief Constructs a closed presenter. */
+    CGdiPresenter();
+
+    /** @brief Closes the window and releases the DIB section. */
+    ~CGdiPresenter();
+
+    /**
+     * @brief Opens a window with a DIB section of the given size.
+     *
+     * @param title Window title
+     * @param size Frame size in pixels
+     * @return false if the window or DIB section cannot be created
+     */
+    bool open(const std::string& title, cv::Size size);
+
+    /** @brief Closes the window and releases the DIB section. */
+    void close();
+
+    /// @brief True while a window is open.
+    bool is_open() const { return _g != nullptr; }
+
+    /**
+     * @brief Shows a frame.
+     *
+     * @param frame Frame to show (CV_8UC3, same size as the window)
+     * @param damage Regions changed since the last present; empty for the whole frame
+     */
+    void present(const cv::Mat& frame, const std::vector<cv::Rect>& damage);
+
+    /**
+     * @brief Returns the last key pressed in the window.
+     *
+     * @return Lower-case ASCII key code, 'q' when the window was closed, or -1
+     */
+    int poll_key();
+};
@@ -0,0 +1,149 @@
+#include "stdafx.h"
+#include "CInputLog.h"
+#include <climits>
+#include <algorithm>
+
+static const char log_magic[8] = { '4', '6', '1', '8', 'L', 'O', 'G', '2' };
+static const int32_t failed_read = INT32_MIN;
+
+CInputLog::CInputLog()
+{
+    _mode = OFF;
+    _dt = 0.0;
+    _seed = 0;
+    _read_pos = 0;
+    _frame_open = false;
+    _frame_count = 0;
+    _desync_count = 0;
+
+    _values.reserve(64);
+}
+
+CInputLog::~CInputLog()
+{
+    close();
+}
+
+bool CInputLog::open_record(const std::string& path)
+{
+    close();
+
+    _file.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!_file.is_open())
+        return false;
+
+    _file.write(log_magic, sizeof(log_magic));
+
+    _mode = RECORD;
+    _frame_count = 0;
+    _desync_count = 0;
+    return true;
+}
+
+bool CInputLog::open_replay(const std::string& path)
+{
+    close();
+
+    _file.open(path.c_str(), std::ios::in | std::ios::binary);
+    if (!_file.is_open())
+        return false;
+
+    char magic[sizeof(log_magic)] = { 0 };
+    _file.read(magic, sizeof(magic));
+
+    if (!_file || !std::equal(magic, magic + sizeof(magic), log_magic))
+    {
+        _file.close();
+        return false;
+    }
+
+    _mode = REPLAY;
+    _frame_count = 0;
+    _desync_count = 0;
+    return true;
+}
+
+void CInputLog::close()
+{
+    if (_mode == RECORD && _frame_open)
+        write_frame();
+
+    if (_file.is_open())
+        _file.close();
+
+    _mode = OFF;
+    _frame_open = false;
+    _values.clear();
+    _read_pos = 0;
+}
+
+void CInputLog::write_frame()
+{
+    uint16_t count = (uint16_t)_values.size();
+
+    _file.write((const char*)&_dt, sizeof(_dt));
+    _file.write((const char*)&_seed, sizeof(_seed));
+    _file.write((const char*)&count, sizeof(count));
+    _file.write((const char*)_values.data(), count * sizeof(int32_t));
+}
+
+bool CInputLog::begin_frame(double& dt, unsigned int& seed)
+{
+    if (_mode == RECORD)
+    {
+        if (_frame_open)
+            write_frame();
+
+        _dt = dt;
+        _seed = seed;
+        _values.clear();
+    }
+    else if (_mode == REPLAY)
+    {
+        // Game read a different number of inputs than it did while recording
+        if (_frame_open && _read_pos != _values.size())
+            _desync_count++;
+
+        uint16_t count = 0;
+        _file.read((char*)&_dt, sizeof(_dt));
+        _file.read((char*)&_seed, sizeof(_seed));
+        _file.read((char*)&count, sizeof(count));
+
+        _values.resize(count);   // capacity is reused between frames
+        _file.read((char*)_values.data(), count * sizeof(int32_t));
+
+        if (!_file)
+            return false;
+
+        dt = _dt;
+        seed = _seed;
+        _read_pos = 0;
+    }
+    else
+    {
+        return true;
+    }
+
+    _frame_open = true;
+    _frame_count++;
+    return true;
+}
+
+void CInputLog::record(int value, bool ok)
+{
+    if (_mode == RECORD && _values.size() < UINT16_MAX)
+        _values.push_back(ok ? (int32_t)value : failed_read);
+}
+
+bool CInputLog::replay(int& value)
+{
+    if (_mode != REPLAY || _read_pos >= _values.size())
+        return false;
+
+    int32_t stored = _values[_read_pos++];
+    if (stored == failed_read)
+        return false;
+
+    value = stored;
+    return true;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @file CInputLog.h
+ * @brief Per-frame input recording and deterministic replay.
+ *
+ * File format (little endian, binary):
+ *  header: "4618LOG2"
+ *  frame:  double dt, uint32 seed, uint16 count, int32 value[count]
+ *
+ * A failed hardware read is stored as INT32_MIN.
+ */
+
+ /**
+  * @class CInputLog
+  * @brief Records or replays everything a frame reads from the outside world.
+  *
+  * In record mode every value returned by CControl, and every key, widget
+  * event and loop setting CBase4618::log_input() sees, is appended to the
+  * current frame together with the frame delta time and RNG seed. In replay mode the
+  * same values are returned in the same order, so the game loop does exactly
+  * the same work on every run regardless of hardware or wall-clock timing.
+  */
+class CInputLog
+{
+public:
+    /**
+     * @enum Mode
+     * @brief Current operating mode of the log.
+     */
+    enum Mode
+    {
+        OFF = 0,    /**< Inputs are read live and not stored */
+        RECORD = 1, /**< Inputs are read live and stored */
+        REPLAY = 2  /**< Inputs are read from the log */
+    };
+
+    /**
+     * @brief Constructs a log in OFF mode.
+     */
+    CInputLog();
+
+    /**
+     * @brief Flushes and closes any open log file.
+     */
+    ~CInputLog();
+
+    /**
+     * @brief Starts recording into a new file.
+     *
+     * @param path Log file to create
+     * @return true if the file was opened
+     */
+    bool open_record(const std::string& path);
+
+    /**
+     * @brief Starts replaying an existing file.
+     *
+     * @param path Log file to read
+     * @return true if the file was opened and has a valid header
+     */
+    bool open_replay(const std::string& path);
+
+    /**
+     * @brief Flushes the current frame and closes the file.
+     */
+    void close();
+
+    /// @brief Get the current mode.
+    Mode get_mode() const { return _mode; }
+
+    /// @brief True while recording.
+    bool is_recording() const { return _mode == RECORD; }
+
+    /// @brief True while replaying.
+    bool is_replaying() const { return _mode == REPLAY; }
+
+    /**
+     * @brief Starts a new frame.
+     *
+     * RECORD: stores dt and seed for the new frame.
+     * REPLAY: overwrites dt and seed with the recorded values.
+     *
+     * @param dt Frame delta time in seconds
+     * @param seed RNG seed used for this frame
+     * @return false when a replay has reached the end of the log
+     */
+    bool begin_frame(double& dt, unsigned int& seed);
+
+    /**
+     * @brief Stores one input value in the current frame (RECORD mode).
+     *
+     * @param value Value returned to the application
+     * @param ok Result of the hardware read
+     */
+    void record(int value, bool ok);
+
+    /**
+     * @brief Returns the next recorded input value (REPLAY mode).
+     *
+     * value is left untouched if the recorded read failed.
+     *
+     * @param value Receives the recorded value
+     * @return Recorded result of the hardware read
+     */
+    bool replay(int& value);
+
+    /// @brief Number of frames recorded or replayed so far.
+    int get_frame_count() const { return _frame_count; }
+
+    /// @brief Number of replayed frames that read a different number of inputs than recorded.
+    int get_desync_count() const { return _desync_count; }
+
+private:
+    /** @brief Writes the buffered frame to disk (RECORD mode). */
+    void write_frame();
+
+    Mode _mode;                       ///< Current mode
+    std::fstream _file;               ///< Open log file
+    double _dt;                       ///< Delta time of the current frame
+    uint32_t _seed;                   ///< RNG seed of the current frame
+    std::vector<int32_t> _values;     ///< Inputs of the current frame
+    size_t _read_pos;                 ///< Next value to replay
+    bool _frame_open;                 ///< True once begin_frame has been called
+    int _frame_count;                 ///< Frames recorded or replayed
+    int _desync_count;                ///< Replay frames with mismatched input count
+};
@@ -0,0 +1,133 @@
+#include "stdafx.h"
+#include "CLayerCache.h"
+#include <algorithm>
+
+CLayerCache::CLayerCache()
+{
+    _hits = 0;
+    _misses = 0;
+}
+
+int CLayerCache::add_layer(const cv::Rect& area, bool opaque)
+{
+    Layer layer;
+    layer.area = area;
+    layer.opaque = opaque && !area.empty();
+    layer.valid = false;
+    layer.key = 0;
+    layer.type = -1;
+
+    _layers.push_back(layer);
+    return (int)_layers.size() - 1;
+}
+
+void CLayerCache::invalidate(int id)
+{
+    for (int i = 0; i < (int)_layers.size(); i++)
+    {
+        if (id < 0 || id == i)
+            _layers[i].valid = false;
+    }
+}
+
+void CLayerCache::composite(const Layer& layer, cv::Mat& im)
+{
+    if (layer.bounds.empty())
+        return;
+
+    cv::Mat dst = im(layer.bounds);
+    if (layer.opaque)
+        layer.pixels.copyTo(dst);
+    else
+        layer.pixels.copyTo(dst, layer.mask);
+}
+
+void CLayerCache::capture(Layer& layer, const cv::Rect& area)
+{
+    cv::Mat src = _scratch(area);
+    cv::Mat mask(area.size(), CV_8UC1);
+    int cn = src.channels();
+
+    // Anything not black was drawn; track its bounding box on the way
+    int x0 = area.width, x1 = -1, y0 = area.height, y1 = -1;
+    for (int y = 0; y < area.height; y++)
+    {
+        const uchar* s = src.ptr<uchar>(y);
+        uchar* m = mask.ptr<uchar>(y);
+
+        for (int x = 0; x < area.width; x++)
+        {
+            uchar v = 0;
+            for (int c = 0; c < cn; c++)
+                v |= s[x * cn + c];
+
+            m[x] = v ? 255 : 0;
+            if (v)
+            {
+                x0 = std::min(x0, x);
+                x1 = std::max(x1, x);
+                y0 = std::min(y0, y);
+                y1 = y;
+            }
+        }
+    }
+
+    if (x1 < 0)
+    {
+        layer.bounds = cv::Rect();
+        layer.pixels.release();
+        layer.mask.release();
+        return;
+    }
+
+    cv::Rect box(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+    src(box).copyTo(layer.pixels);
+    mask(box).copyTo(layer.mask);
+    layer.bounds = box + area.tl();
+}
+
+bool CLayerCache::draw(cv::Mat& im, int id, uint64_t key, const std::function<void(cv::Mat&)>& render)
+{
+    if (id < 0 || id >= (int)_layers.size() || im.depth() != CV_8U)
+    {
+        render(im);
+        return false;
+    }
+
+    Layer& layer = _layers[id];
+
+    if (layer.valid && layer.key == key && layer.canvas == im.size() && layer.type == im.type())
+    {
+        composite(layer, im);
+        _hits++;
+        return true;
+    }
+
+    cv::Rect full(0, 0, im.cols, im.rows);
+    cv::Rect area = layer.area.empty() ? full : (layer.area & full);
+
+    if (layer.opaque)
+    {
+        // Drawn in place; the area is copied out afterwards
+        render(im);
+        im(area).copyTo(layer.pixels);
+        layer.bounds = area;
+    }
+    else
+    {
+        if (_scratch.size() != im.size() || _scratch.type() != im.type())
+            _scratch.create(im.size(), im.type());
+
+        _scratch(area).setTo(cv::Scalar::all(0));
+        render(_scratch);
+        capture(layer, area);
+        composite(layer, im);
+    }
+
+    layer.key = key;
+    layer.canvas = im.size();
+    layer.type = im.type();
+    layer.valid = true;
+    _misses++;
+    return false;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @file CLayerCache.h
+ * @brief Cached composition of frame layers that rarely change.
+ */
+
+ /**
+  * @class CLayerCache
+  * @brief Redraws a layer only when its invalidation key changes.
+  *
+  * Applications declare layers such as a static background, a settings
+  * panel, a button or a game over banner, and draw each one every frame
+  * through draw() with a key summarising its inputs (a state enum, a score,
+  * a hover state). While the key matches the cached one the layer's pixels
+  * are copied back from the cache and its render function is not called,
+  * so Hershey text and cvui frames are only stroked when they change.
+  *
+  * Opaque layers cover a fixed area and are cached as a plain copy of it.
+  * Transparent layers are rendered into a cleared scratch image; their
+  * black pixels are treated as transparent and only the bounding box of
+  * what was drawn is kept.
+  *
+  * Only 8-bit canvases are supported (BGR or indexed).
+  *
+  * Render functions draw with canvas coordinates. Interactive widgets can
+  * be cached if their interaction state is part of the key and the layer is
+  * invalidated on the frame the widget must report a click.
+  */
+class CLayerCache
+{
+private:
+    /**
+     * @brief One declared layer.
+     */
+    struct Layer
+    {
+        cv::Rect area;      ///< Pixels the layer may cover; empty for the whole canvas
+        bool opaque;        ///< True if the layer overwrites its whole area
+        bool valid;         ///< True if pixels hold the layer for key
+        uint64_t key;       ///< Invalidation key of the cached pixels
+        cv::Size canvas;    ///< Canvas size the pixels were rendered for
+        int type;           ///< Canvas type the pixels were rendered for
+        cv::Rect bounds;    ///< Canvas region of the cached pixels
+        cv::Mat pixels;     ///< Cached pixels, same type as the canvas
+        cv::Mat mask;       ///< Drawn pixels of a transparent layer (CV_8UC1)
+    };
+
+    std::vector<Layer> _layers; ///< Declared layers by id
+    cv::Mat _scratch;           ///< Render target for transparent layers
+    int _hits;                  ///< Layers composited from the cache
+    int _misses;                ///< Layers rendered
+
+    /**
+     * @brief Copies a freshly rendered transparent layer out of _scratch.
+     *
+     * @param layer Layer to fill
+     * @param area Cleared region of _scratch the layer was rendered into
+     */
+    void capture(Layer& layer, const cv::Rect& area);
+
+    /** @brief Copies a layer's cached pixels onto the canvas. */
+    static void composite(const Layer& layer, cv::Mat& im);
+
+public:
+    /** @brief Constructs a cache without layers. */
+    CLayerCache();
+
+    /**
+     * @brief Declares a layer.
+     *
+     * @param area Canvas region the layer may cover; empty for the whole canvas
+     * @param opaque True if the layer overwrites every pixel of area
+     * @return Layer id for draw() and invalidate()
+     */
+    int add_layer(const cv::Rect& area = cv::Rect(), bool opaque = false);
+
+    /**
+     * @brief Draws a layer onto the canvas, from the cache if its key is unchanged.
+     *
+     * @param im Canvas to draw on
+     * @param id Layer id from add_layer()
+     * @param key Value that changes whenever the layer's content would
+     * @param render Draws the layer onto the Mat it is given, in canvas coordinates
+     * @return true if the layer came from the cache
+     */
+    bool draw(cv::Mat& im, int id, uint64_t key, const std::function<void(cv::Mat&)>& render);
+
+    /**
+     * @brief Forces a layer to be rendered the next time it is drawn.
+     *
+     * @param id Layer id, or -1 for every layer
+     */
+    void invalidate(int id = -1);
+
+    /// @brief Layers composited from the cache so far.
+    int get_hits() const { return _hits; }
+
+    /// @brief Layers rendered so far.
+    int get_misses() const { return _misses; }
+};
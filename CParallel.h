@@ -0,0 +1,92 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @file CParallel.h
+ * @brief Deterministic chunked parallel loops over entity ranges.
+ *
+ * A range of entities is cut into fixed-size chunks and the chunks are
+ * handed to cv::parallel_for_ one stripe each. This is not a job system
+ * with per-thread queues and work stealing; it adapts that idea to the
+ * pool OpenCV already has (the Concurrency runtime on Windows, TBB or
+ * OpenMP where built in). Asking for one stripe per chunk lets that pool
+ * hand chunks to whichever worker is idle, so an uneven chunk does not
+ * hold up the others, without the project owning threads of its own.
+ *
+ * Chunk boundaries depend only on the entity count and chunk size, never
+ * on the number of threads, and results that must be combined are written
+ * per chunk and merged in chunk order by the caller. A frame therefore
+ * computes the same result on 1 thread or 16, and replays of a CInputLog
+ * stay in sync. Work that needs random numbers uses
+ * parallel_chunks_seeded(), which gives each chunk its own generator.
+ */
+
+#define PARALLEL_CHUNK 256    // entities per chunk; the game's pools hold a few hundred to a few thousand
+
+/**
+ * @brief Number of chunks a range is split into.
+ *
+ * @param count Entities in the range
+ * @param chunk Entities per chunk
+ * @return Chunk count (0 for an empty range)
+ */
+inline int chunk_count(int count, int chunk = PARALLEL_CHUNK)
+{
+    return (count + chunk - 1) / chunk;
+}
+
+/**
+ * @brief Runs fn over [0, count) in parallel fixed-size chunks.
+ *
+ * @param count Entities to process
+ * @param fn Called as fn(chunk index, cv::Range of entities)
+ * @param chunk Entities per chunk
+ */
+template <typename F>
+void parallel_chunks(int count, F fn, int chunk = PARALLEL_CHUNK)
+{
+    int chunks = chunk_count(count, chunk);
+
+    auto run = [&](int c)
+    {
+        fn(c, cv::Range(c * chunk, std::min(count, (c + 1) * chunk)));
+    };
+
+    // A single chunk runs inline rather than waking the pool
+    if (chunks == 1)
+    {
+        run(0);
+        return;
+    }
+
+    cv::parallel_for_(cv::Range(0, chunks), [&](const cv::Range& range)
+    {
+        for (int c = range.start; c < range.end; c++)
+            run(c);
+    }, chunks);
+}
+
+/**
+ * @brief Runs fn over [0, count) in parallel fixed-size chunks, each with its own generator.
+ *
+ * The generator of a chunk is seeded from the seed and the chunk index, so
+ * it draws the same numbers whichever thread runs the chunk.
+ *
+ * @param count Entities to process
+ * @param seed Frame seed for the per-chunk generators
+ * @param fn Called as fn(chunk index, cv::Range of entities, cv::RNG&)
+ * @param chunk Entities per chunk
+ */
+template <typename F>
+void parallel_chunks_seeded(int count, uint64_t seed, F fn, int chunk = PARALLEL_CHUNK)
+{
+    parallel_chunks(count, [&](int c, const cv::Range& r)
+    {
+        // Distinct, well spread streams per chunk
+        cv::RNG rng(seed * 0x9E3779B97F4A7C15ULL + (uint64_t)(c + 1) * 0xBF58476D1CE4E5B9ULL);
+        fn(c, r, rng);
+    }, chunk);
+}
@@ -0,0 +1,134 @@
+#include "stdafx.h"
+#include "CPerfHUD.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cstdio>
+#include "cvui.h"
+
+#define HUD_WIDTH    330   // panel width in pixels
+#define HUD_ROW_H    30    // height of one series row
+#define HUD_MARGIN   10    // distance from the canvas edge
+#define HUD_PAD      4     // inner padding of the panel
+#define HUD_HEADER_H 14    // height of the column header row
+#define HUD_SPARK_X  200   // sparkline x offset inside a row
+#define HUD_SPARK_W  122   // sparkline width
+#define HUD_TEXT_SCALE 0.8
+
+CPerfHUD::CPerfHUD(size_t history_len, int refresh_frames)
+{
+    _history_len = history_len;
+    _refresh_frames = refresh_frames;
+    _frames_since_refresh = refresh_frames;
+    _visible = false;
+
+    _plot.reserve(history_len);
+    _sorted.reserve(history_len);
+}
+
+int CPerfHUD::add_series(const std::string& name, unsigned int color)
+{
+    Series s;
+    s.name = name;
+    s.color = color;
+    s.history.set_capacity(_history_len);
+    s.min_ms = 0.0;
+    s.avg_ms = 0.0;
+    s.p99_ms = 0.0;
+
+    _series.push_back(s);
+
+    // The cached panel is one row short now; rebuild it on the next draw
+    _frames_since_refresh = _refresh_frames;
+    return (int)_series.size() - 1;
+}
+
+void CPerfHUD::add_sample(int series, double ms)
+{
+    if (series >= 0 && series < (int)_series.size())
+        _series[series].history.push(ms);
+}
+
+void CPerfHUD::update_stats(Series& s)
+{
+    if (s.history.empty())
+        return;
+
+    s.history.copy_to(_sorted);
+
+    double sum = 0.0;
+    for (double v : _sorted)
+        sum += v;
+
+    s.avg_ms = sum / _sorted.size();
+    s.min_ms = *std::min_element(_sorted.begin(), _sorted.end());
+
+    // Partial sort is enough to find a single percentile
+    size_t p99_index = (size_t)(0.99 * (_sorted.size() - 1));
+    std::nth_element(_sorted.begin(), _sorted.begin() + p99_index, _sorted.end());
+    s.p99_ms = _sorted[p99_index];
+}
+
+cv::Rect CPerfHUD::get_rect(cv::Size canvas_size) const
+{
+    int height = 2 * HUD_PAD + HUD_HEADER_H + (int)_series.size() * HUD_ROW_H;
+    cv::Rect hud(HUD_MARGIN, canvas_size.height - height - HUD_MARGIN, HUD_WIDTH, height);
+
+    return hud & cv::Rect(0, 0, canvas_size.width, canvas_size.height);
+}
+
+void CPerfHUD::render_panel()
+{
+    int height = 2 * HUD_PAD + HUD_HEADER_H + (int)_series.size() * HUD_ROW_H;
+
+    _panel.create(height, HUD_WIDTH, CV_8UC3);   // reallocates only when a series is added
+    _panel.setTo(cv::Scalar(30, 30, 30));
+
+    cv::putText(_panel, "ms       min   avg   p99",
+        cv::Point(HUD_PAD, HUD_PAD + HUD_HEADER_H - 3),
+        cv::FONT_HERSHEY_PLAIN,
+        HUD_TEXT_SCALE,
+        cv::Scalar(150, 150, 150),
+        1);
+
+    char line[64];
+    int y = HUD_PAD + HUD_HEADER_H;
+
+    for (auto& s : _series)
+    {
+        update_stats(s);
+
+        std::snprintf(line, sizeof(line), "%-6s %5.1f %5.1f %5.1f",
+            s.name.c_str(), s.min_ms, s.avg_ms, s.p99_ms);
+
+        cv::putText(_panel, line,
+            cv::Point(HUD_PAD, y + HUD_ROW_H / 2 + 5),
+            cv::FONT_HERSHEY_PLAIN,
+            HUD_TEXT_SCALE,
+            cv::Scalar(220, 220, 220),
+            1);
+
+        // A flat series has no range to plot
+        s.history.copy_to(_plot);
+        if (_plot.size() >= 2 && s.p99_ms > s.min_ms)
+            cvui::sparkline(_panel, _plot, HUD_SPARK_X, y + 2, HUD_SPARK_W, HUD_ROW_H - 4, s.color);
+
+        y += HUD_ROW_H;
+    }
+
+    _frames_since_refresh = 0;
+}
+
+void CPerfHUD::draw(cv::Mat& im)
+{
+    if (!_visible || _series.empty())
+        return;
+
+    if (++_frames_since_refresh >= _refresh_frames)
+        render_panel();
+
+    cv::Rect hud = get_rect(im.size());
+    if (hud.empty())
+        return;
+
+    _panel(cv::Rect(0, 0, hud.width, hud.height)).copyTo(im(hud));
+}
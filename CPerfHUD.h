@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CRingBuffer.h"
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @file CPerfHUD.h
+ * @brief Frame timing overlay shared by all CBase4618 applications.
+ */
+
+ /**
+  * @class CPerfHUD
+  * @brief Collects per-frame timings and draws min/avg/p99 with sparklines.
+  *
+  * Each timing series (frame, gpio, update, draw, ...) keeps its history in a
+  * CRingBuffer so recording a sample never allocates. The overlay is rendered
+  * into a small cached panel that is only refreshed every few frames; on all
+  * other frames drawing the HUD is a single small block copy.
+  */
+class CPerfHUD
+{
+private:
+    /**
+     * @brief History and cached statistics for one timing series.
+     */
+    struct Series
+    {
+        std::string name;           ///< Label drawn in the panel
+        unsigned int color;         ///< Sparkline colour (0xRRGGBB)
+        CRingBuffer<double> history;///< Recent samples (ms)
+        double min_ms;              ///< Minimum over the history
+        double avg_ms;              ///< Average over the history
+        double p99_ms;              ///< 99th percentile over the history
+    };
+
+    std::vector<Series> _series;   ///< All registered series
+    std::vector<double> _plot;     ///< Scratch copy in chronological order
+    std::vector<double> _sorted;   ///< Scratch copy for percentile selection
+
+    cv::Mat _panel;                ///< Cached rendering of the overlay
+    size_t _history_len;           ///< Samples kept per series
+    int _refresh_frames;           ///< Frames between panel re-renders
+    int _frames_since_refresh;     ///< Frames since the panel was rendered
+    bool _visible;                 ///< True if the overlay is drawn
+
+    /** @brief Recomputes min/avg/p99 for a series. */
+    void update_stats(Series& s);
+
+    /** @brief Renders all series into _panel. */
+    void render_panel();
+
+public:
+    /**
+     * @brief Constructs an empty, hidden HUD.
+     *
+     * @param history_len Number of samples kept per series
+     * @param refresh_frames Number of frames between panel re-renders
+     */
+    CPerfHUD(size_t history_len = 120, int refresh_frames = 10);
+
+    /**
+     * @brief Registers a new timing series.
+     *
+     * @param name Label shown in the overlay
+     * @param color Sparkline colour in the format 0xRRGGBB
+     * @return Index used with add_sample
+     */
+    int add_series(const std::string& name, unsigned int color);
+
+    /**
+     * @brief Records one sample for a series.
+     *
+     * @param series Index returned by add_series
+     * @param ms Sample value in milliseconds
+     */
+    void add_sample(int series, double ms);
+
+    /** @brief Shows or hides the overlay. */
+    void toggle() { _visible = !_visible; _frames_since_refresh = _refresh_frames; }
+
+    /// @brief True if the overlay is drawn.
+    bool is_visible() const { return _visible; }
+
+    /**
+     * @brief Area of the canvas covered by the overlay.
+     *
+     * @param canvas_size Size of the canvas the HUD is drawn on
+     * @return Overlay rectangle, clipped to the canvas
+     */
+    cv::Rect get_rect(cv::Size canvas_size) const;
+
+    /**
+     * @brief Draws the overlay into the bottom left corner of im.
+     *
+     * Does nothing while the HUD is hidden.
+     *
+     * @param im Canvas to draw on (CV_8UC3)
+     */
+    void draw(cv::Mat& im);
+};
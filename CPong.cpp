@@ -4,54 +4,160 @@
 #include <cstdlib>
 #include <ctime>
 #include <cmath>
+#include <cstdio>
 #include "cvui.h"
 #include <thread>
+#include <cfloat>
+#include <algorithm>
 
 #define JOYSTICK_Y 26
 #define JOY_DEADZONE 5.0
 #define BUTTON_S1 33
 #define BUTTON_S2  32
+#define DIRTY_PAD 2     // pixels added around each dirty rectangle
+#define PEN_BLACK 0     // palette indices used by the world
+#define PEN_WHITE 1
+#define PEN_RED 2
+#define SIM_DT (1.0 / 40.0)    // physics step the speeds were tuned at
+#define FRAME_DT (1.0 / 60.0)  // render pacing; drawn frames are interpolated between steps
+#define MAX_BOUNCES 4           // impacts resolved within one physics step
 
 void CPong::gpio()
 {
 	_control.get_analog_percent(JOYSTICK_Y, _joy_y_pct);
 
 	if (_control.get_button_debounced(BUTTON_S1))
+	{
 		_settings_event = true;
+		tag_frame(_control.get_input_tag(DIGITAL, BUTTON_S1));
+	}
 	if (_control.get_button_debounced(BUTTON_S2))
+	{
 		reset_game();
+		tag_frame(_control.get_input_tag(DIGITAL, BUTTON_S2));
+	}
 }
 
 void CPong::update()
 {
 	update_timing();
+
+	// cvui events are raised in draw(), which an idle frame skips, so they
+	// are logged here where every frame, recorded or replayed, reads them
+	_settings_event = log_action(_settings_event);
+	if (_settings_open)
+	{
+		_ball_radius = log_input(_ball_radius);
+		_ball_speed = log_input(_ball_speed);
+		_paddle_speed = log_input(_paddle_speed);
+	}
+
+	if (_settings_event)
+		_frame_changed = true;
 	handle_settings_event();
 
 		if (!_settings_open && !_game_over)
 		{
-			update_ball((float)_target_dt);
-			update_right_paddle();
-			update_left_paddle();
-			clamp_ball_inside();
-			check_wall_collision();
-			check_paddle_collision();
+			_frame_changed = true;
+
+			// Paddle position is the latency-critical use of the joystick
+			latch_analog(JOYSTICK_Y, _joy_y_pct);
+
+			int paddle_y = _right_paddle.y;
+			int steps = fixed_steps();
+			for (int i = 0; i < steps && !_game_over; i++)
+				step((float)_sim_dt);
+
+			if (_right_paddle.y != paddle_y)
+				tag_frame(_control.get_input_tag(ANALOG, JOYSTICK_Y));
 		}
 }
 
+void CPong::step(float dt)
+{
+	_ball_prev = _ball_pos;
+	_left_prev_y = _left_paddle.y;
+	_right_prev_y = _right_paddle.y;
+
+	// Ball first, as before the sweep; it bounces off the paddles where the
+	// last step left them, and the left paddle then follows it
+	update_ball(dt);
+	update_right_paddle();
+	update_left_paddle();
+	clamp_ball_inside();
+	check_wall_collision();
+}
+
 void CPong::draw()
 {
-	_canvas.setTo(cv::Scalar(0, 0, 0));
+	// Overlays cover most of the canvas, so clear everything while one is up
+	// and for two frames after, until both buffers are clean again
+	bool full = _settings_open || _game_over || _full_redraw_frames > 0;
+
+	if (_settings_open || _game_over)
+		_full_redraw_frames = 2;
+	else if (_full_redraw_frames > 0)
+		_full_redraw_frames--;
+
+	if (full)
+	{
+		_world.setTo(pen(PEN_BLACK));
+	}
+	else
+	{
+		// The back buffer still holds the frame from two presents ago
+		for (const cv::Rect& r : _drawn[_back_buffer])
+			_world(r).setTo(pen(PEN_BLACK));
+	}
+
+	_boxes.clear();
 
 	draw_game();
 	draw_ui();
 
-	if (_settings_open)
-		draw_settings_panel();
+	// The HUD is drawn over the frame at present time
+	if (_perf_hud.is_visible())
+		add_box(_perf_hud.get_rect(_size));
+
 	if (_game_over)
 		draw_game_over();
 
-	cvui::update();
-	cv::imshow(_window_name, _canvas);
+	// Changes relative to the frame on screen: what it showed and what this one shows
+	if (!full)
+	{
+		for (const cv::Rect& r : _drawn[_back_buffer ^ 1])
+			add_damage(r);
+		for (const cv::Rect& r : _boxes)
+			add_damage(r);
+
+		// An indexed world only needs its palette applied where pixels changed
+		if (_indexed)
+		{
+			_world_dirty.insert(_world_dirty.end(), _drawn[_back_buffer].begin(), _drawn[_back_buffer].end());
+			_world_dirty.insert(_world_dirty.end(), _boxes.begin(), _boxes.end());
+		}
+	}
+
+	_drawn[_back_buffer].swap(_boxes);
+}
+
+void CPong::draw_overlay()
+{
+	// cvui widgets stay in BGR on the resolved canvas. The button only
+	// looks different while hovered or pressed, and must run on a click
+	cv::Rect settings_button(_size.width - 120, 10, 110, 35);
+	int state = cvui::iarea(settings_button.x, settings_button.y, settings_button.width, settings_button.height);
+	if (state == cvui::CLICK)
+		_layers.invalidate(_layer_button);
+
+	_layers.draw(_canvas, _layer_button, (uint64_t)state, [&](cv::Mat& im)
+	{
+		if (cvui::button(im, settings_button.x, settings_button.y, settings_button.width, settings_button.height, "SETTINGS"))
+			_settings_event = true;
+	});
+
+	if (_settings_open)
+		draw_settings_panel();
 }
 
 CPong::CPong(cv::Size size, int comport)
@@ -59,11 +165,11 @@ CPong::CPong(cv::Size size, int comport)
 	_size = size;
 	_control.init_com(comport);
 
-	// Rand set up
-	srand((unsigned int)time(NULL));
+	// rand() is seeded per frame by CBase4618
 
 	// joystick
 	_joy_y_pct = 50.0;
+	_latch_channels.push_back(JOYSTICK_Y);
 
 	// window 
 	_window_name = "Lab 5 Pong";
@@ -73,7 +179,22 @@ CPong::CPong(cv::Size size, int comport)
 	cvui::init(_window_name);
 
 	//canvas
-	_canvas = cv::Mat::zeros(_size, CV_8UC3);
+	create_canvas(_size);
+	_full_redraw_frames = 2;
+
+	// Monochrome plus red game over text; fits the 8-bit indexed world
+	set_palette(PEN_BLACK, cv::Scalar(0, 0, 0));
+	set_palette(PEN_WHITE, cv::Scalar(255, 255, 255));
+	set_palette(PEN_RED, cv::Scalar(0, 0, 255));
+	_indexed_supported = true;
+
+	// Invariant overlays are composited from the layer cache
+	_layer_button = _layers.add_layer(cv::Rect(_size.width - 120, 10, 110, 35), true);
+	_layer_panel = _layers.add_layer(cv::Rect((_size.width - 450) / 2, (_size.height - 330) / 2, 450, 330), true);
+	_layer_game_over = _layers.add_layer();
+	_boxes.reserve(16);
+	_drawn[0].reserve(16);
+	_drawn[1].reserve(16);
 
 	// Ball
 	_ball_radius = 20;
@@ -91,6 +212,8 @@ CPong::CPong(cv::Size size, int comport)
 	// cv::Rect(x, y, width, height)
 	_left_paddle = cv::Rect( 40, (_size.height - paddle_h) / 2, paddle_w, paddle_h );
 	_right_paddle = cv::Rect( _size.width - 40 - paddle_w, (_size.height - paddle_h) / 2, paddle_w, paddle_h );
+	_left_prev_y = _left_paddle.y;
+	_right_prev_y = _right_paddle.y;
 
 	//events
 	_settings_event = false;
@@ -101,8 +224,13 @@ CPong::CPong(cv::Size size, int comport)
 	_fps = 0;
 	_fps_sum = 0.0f;
 	_max_samples = 100;
+	_fps_history.set_capacity(_max_samples);
 	_avg_fps = 0.0;
-	_target_dt = 1.0f / 40.0f;
+	_target_dt = FRAME_DT;
+	set_fixed_timestep(SIM_DT);
+
+	// Paused (settings or game over) frames drop to the idle refresh rate
+	set_idle_policy(true);
 	
 	reset_game();
 }
@@ -131,23 +259,22 @@ void CPong::update_timing()
 
 	_fps = 1.0 / dt;
 
+	// Drop the oldest fps once the history is full
+	if (_fps_history.full())
+		_fps_sum -= _fps_history.front();
+
 	// Add new fps
-	_fps_history.push_back(_fps);
+	_fps_history.push(_fps);
 	_fps_sum += _fps;
 
-	// Keep only last 100
-	if (_fps_history.size() > _max_samples)
-	{
-		_fps_sum -= _fps_history.front();
-		_fps_history.erase(_fps_history.begin());
-	}
-
 	_avg_fps = _fps_sum / _fps_history.size();
 }
 void CPong::reset_ball()
 {
 	// Center ball
 	_ball_pos = cv::Point2f(_size.width / 2.0f, _size.height / 2.0f);
+	_ball_prev = _ball_pos;   // no blend across the jump to the centre
+	_sweep_carry = 0.0f;
 
 	float component = _ball_speed / std::sqrt(2.0f);
 
@@ -165,24 +292,22 @@ void CPong::reset_game()
 	_score_right = 0;
 
 	_game_over = false;
+	_frame_changed = true;
 
 	reset_ball();
 }
-void CPong::check_wall_collision()
+// Time for a coordinate moving at vel to reach plane, or FLT_MAX if it never does
+static float time_to_reach(float pos, float vel, float plane)
 {
-	// Top wall
-	if (_ball_pos.y - _ball_radius <= 0)
-	{
-		_ball_pos.y = (float)_ball_radius;
-		_ball_vel.y *= -1.0f;
-	}
+	if (vel == 0.0f)
+		return FLT_MAX;
 
-	// Bottom wall
-	if (_ball_pos.y + _ball_radius >= _size.height)
-	{
-		_ball_pos.y = (float)(_size.height - _ball_radius);
-		_ball_vel.y *= -1.0f;
-	}
+	float t = (plane - pos) / vel;
+	return t >= 0.0f ? t : FLT_MAX;
+}
+void CPong::check_wall_collision()
+{
+	// Top and bottom bounces are resolved by the sweep in update_ball()
 
 	// Left wall → right player scores
 	if (_ball_pos.x - _ball_radius <= 0)
@@ -214,27 +339,6 @@ void CPong::check_wall_collision()
 		}
 	}
 }
-void CPong::check_paddle_collision() {
-	// Left paddle
-	if (_ball_pos.x - _ball_radius <= _left_paddle.x + _left_paddle.width &&
-		_ball_pos.y >= _left_paddle.y &&
-		_ball_pos.y <= _left_paddle.y + _left_paddle.height &&
-		_ball_vel.x < 0)
-	{
-		_ball_pos.x = _left_paddle.x + _left_paddle.width + _ball_radius;
-		_ball_vel.x *= -1.0f;
-	}
-
-	// Right paddle
-	if (_ball_pos.x + _ball_radius >= _right_paddle.x &&
-		_ball_pos.y >= _right_paddle.y &&
-		_ball_pos.y <= _right_paddle.y + _right_paddle.height &&
-		_ball_vel.x > 0)
-	{
-		_ball_pos.x = _right_paddle.x - _ball_radius;
-		_ball_vel.x *= -1.0f;
-	}
-}
 void CPong::handle_settings_event()
 {
 	if (_settings_event)
@@ -253,8 +357,65 @@ void CPong::update_ball(float dt)
 		_ball_vel.y = (_ball_vel.y / mag) * _ball_speed;
 	}
 
-	_ball_pos.x += _ball_vel.x * dt;
-	_ball_pos.y += _ball_vel.y * dt;
+	// Planes the ball centre bounces off: the walls and paddle faces pushed in by the radius
+	float top = (float)_ball_radius;
+	float bottom = (float)(_size.height - _ball_radius);
+	float left_face = (float)(_left_paddle.x + _left_paddle.width + _ball_radius);
+	float right_face = (float)(_right_paddle.x - _ball_radius);
+
+	// Sweep to the earliest impact, bounce, and carry on with the rest of the step,
+	// so a fast ball cannot pass through a paddle between two steps
+	float step = dt;
+	dt += _sweep_carry;
+	for (int i = 0; i < MAX_BOUNCES && dt > 0.0f; i++)
+	{
+		float t_wall = time_to_reach(_ball_pos.y, _ball_vel.y, _ball_vel.y < 0.0f ? top : bottom);
+
+		// Only the face the ball is approaching, and only if the ball is still in front of it
+		const cv::Rect* paddle = NULL;
+		float t_paddle = FLT_MAX;
+		if (_ball_vel.x < 0.0f && _ball_pos.x >= left_face)
+		{
+			paddle = &_left_paddle;
+			t_paddle = time_to_reach(_ball_pos.x, _ball_vel.x, left_face);
+		}
+		else if (_ball_vel.x > 0.0f && _ball_pos.x <= right_face)
+		{
+			paddle = &_right_paddle;
+			t_paddle = time_to_reach(_ball_pos.x, _ball_vel.x, right_face);
+		}
+
+		// The face counts if the ball centre is level with the paddle at impact
+		if (paddle != NULL && t_paddle < FLT_MAX)
+		{
+			float y = _ball_pos.y + _ball_vel.y * t_paddle;
+			if (y < paddle->y || y > paddle->y + paddle->height)
+				t_paddle = FLT_MAX;
+		}
+
+		// Remember which surface is reached first; a paddle wins a tie with the wall
+		bool hit_paddle = t_paddle <= dt && t_paddle <= t_wall;
+		bool hit_wall = !hit_paddle && t_wall <= dt;
+		float t = hit_paddle ? t_paddle : (hit_wall ? t_wall : dt);
+
+		_ball_pos += _ball_vel * t;
+		dt -= t;
+
+		if (hit_paddle)
+		{
+			_ball_pos.x = paddle == &_left_paddle ? left_face : right_face;
+			_ball_vel.x = -_ball_vel.x;
+		}
+		else if (hit_wall)
+		{
+			_ball_pos.y = _ball_vel.y < 0.0f ? top : bottom;
+			_ball_vel.y = -_ball_vel.y;
+		}
+	}
+
+	// A ball wedged between a wall and a paddle can use up MAX_BOUNCES; the
+	// rest moves it next step. At most one step is kept, so it cannot build up.
+	_sweep_carry = std::min(dt, step);
 }
 void CPong::update_right_paddle()
 {
@@ -295,37 +456,59 @@ void CPong::clamp_ball_inside()
 	if (_ball_pos.y + _ball_radius > _size.height)
 		_ball_pos.y = (float)(_size.height - _ball_radius);
 }
-void CPong::draw_game()
+void CPong::add_box(const cv::Rect& r)
 {
-	cv::rectangle(_canvas, _left_paddle, cv::Scalar(255, 255, 255), -1);
-	cv::rectangle(_canvas, _right_paddle, cv::Scalar(255, 255, 255), -1);
+	cv::Rect padded(r.x - DIRTY_PAD, r.y - DIRTY_PAD, r.width + 2 * DIRTY_PAD, r.height + 2 * DIRTY_PAD);
+	cv::Rect box = padded & cv::Rect(0, 0, _size.width, _size.height);
 
-	cv::circle(_canvas,
-		cv::Point((int)_ball_pos.x, (int)_ball_pos.y),
+	if (!box.empty())
+		_boxes.push_back(box);
+}
+void CPong::draw_text(const char* text, cv::Point org)
+{
+	add_box(_hud_text.draw(_world, text, org, pen(PEN_WHITE)));
+}
+void CPong::draw_label(cv::Mat& im, int x, int y, const char* text)
+{
+	_label_text.draw(im, text, cv::Point(x, y + _label_text.get_height()), cv::Scalar(0xCE, 0xCE, 0xCE));
+}
+void CPong::draw_game()
+{
+	// Blend the last two physics steps by how far this frame is into the next one
+	float alpha = (float)_sim_alpha;
+
+	cv::Rect left = _left_paddle;
+	cv::Rect right = _right_paddle;
+	left.y = cvRound(_left_prev_y + (_left_paddle.y - _left_prev_y) * alpha);
+	right.y = cvRound(_right_prev_y + (_right_paddle.y - _right_prev_y) * alpha);
+
+	cv::rectangle(_world, left, pen(PEN_WHITE), -1);
+	cv::rectangle(_world, right, pen(PEN_WHITE), -1);
+	add_box(left);
+	add_box(right);
+
+	cv::Point2f ball = _ball_prev + (_ball_pos - _ball_prev) * alpha;
+	cv::Point center((int)ball.x, (int)ball.y);
+	_sprites.stamp_circle(_world,
+		center,
 		_ball_radius,
-		cv::Scalar(255, 255, 255),
+		pen(PEN_WHITE),
 		-1);
+	add_box(cv::Rect(center.x - _ball_radius, center.y - _ball_radius, 2 * _ball_radius + 1, 2 * _ball_radius + 1));
 }
 void CPong::draw_ui()
 {
-	std::string score = std::to_string(_score_left) + " : " + std::to_string(_score_right);
-	cv::putText(_canvas, score,
-		cv::Point(_size.width / 2 - 40, 50),
-		cv::FONT_HERSHEY_SIMPLEX,
-		1.0,
-		cv::Scalar(255, 255, 255),
-		2);
-
-	std::string fps_text = "FPS: " + std::to_string((int)_avg_fps);
-	cv::putText(_canvas, fps_text,
-		cv::Point(20, 40),
-		cv::FONT_HERSHEY_SIMPLEX,
-		1.0,
-		cv::Scalar(255, 255, 255),
-		2);
-
-	if (cvui::button(_canvas, _size.width - 120, 10, 110, 35, "SETTINGS"))
-		_settings_event = true;
+	// Formatted in place; the renderer caches each distinct string
+	char text[32];
+
+	std::snprintf(text, sizeof(text), "%d : %d", _score_left, _score_right);
+	draw_text(text, cv::Point(_size.width / 2 - 40, 50));
+
+	std::snprintf(text, sizeof(text), "FPS: %d", (int)_avg_fps);
+	draw_text(text, cv::Point(20, 40));
+
+	// The button is drawn by draw_overlay(); cvui redraws it on hover and click
+	add_box(cv::Rect(_size.width - 120, 10, 110, 35));
 }
 void CPong::draw_settings_panel()
 {
@@ -338,28 +521,33 @@ void CPong::draw_settings_panel()
 	int margin_top = 30;
 	int spacing = 80;
 
-	cvui::window(_canvas, px, py, panel_w, panel_h, "Settings");
-
 	int y = py + margin_top;
 
+	// The frame and labels never change; only the widgets are redrawn
+	_layers.draw(_canvas, _layer_panel, 0, [&](cv::Mat& im)
+	{
+		cvui::window(im, px, py, panel_w, panel_h, "Settings");
+		draw_label(im, px + 30, y, "Ball Radius");
+		draw_label(im, px + 30, y + spacing, "Ball Speed");
+		draw_label(im, px + 30, y + 2 * spacing, "Paddle Speed");
+	});
+
 	// Ball Radius
-	cvui::text(_canvas, px + 30, y, "Ball Radius");
 	cvui::trackbar(_canvas, px + 30, y + 20, 380, &_ball_radius, 5, 100);
 
 	y += spacing;
 
 	// Ball Speed
-	cvui::text(_canvas, px + 30, y, "Ball Speed");
 	cvui::trackbar(_canvas, px + 30, y + 20, 380, &_ball_speed, 500, 1500);
 
 	y += spacing;
 
 	// Paddle Speed
-	cvui::text(_canvas, px + 30, y, "Paddle Speed");
 	cvui::trackbar(_canvas, px + 30, y + 20, 380, &_paddle_speed, 10, 30);
 
+	// Closing goes through the logged settings event like the SETTINGS button
 	if (cvui::button(_canvas, px + 110, py + 270, 100, 30, "CLOSE"))
-		_settings_open = false;
+		_settings_event = true;
 
 	if (cvui::button(_canvas, px + 230, py + 270, 100, 30, "EXIT"))
 		_exit = true;
@@ -375,19 +563,23 @@ void CPong::draw_game_over()
 	int x2 = _size.width / 2 - 140;
 	int y2 = _size.height / 2 + 60;
 
-	cv::putText(_canvas,
-		msg1,
-		cv::Point(x1, y1),
-		cv::FONT_HERSHEY_SIMPLEX,
-		2.0,
-		cv::Scalar(0, 0, 255),
-		4);
-
-	cv::putText(_canvas,
-		msg2,
-		cv::Point(x2, y2),
-		cv::FONT_HERSHEY_SIMPLEX,
-		1.0,
-		cv::Scalar(255, 255, 255),
-		2);
+	// Fixed text; stroked once and composited afterwards
+	_layers.draw(_world, _layer_game_over, 0, [&](cv::Mat& im)
+	{
+		cv::putText(im,
+			msg1,
+			cv::Point(x1, y1),
+			cv::FONT_HERSHEY_SIMPLEX,
+			2.0,
+			pen(PEN_RED),
+			4);
+
+		cv::putText(im,
+			msg2,
+			cv::Point(x2, y2),
+			cv::FONT_HERSHEY_SIMPLEX,
+			1.0,
+			pen(PEN_WHITE),
+			2);
+	});
 }
\ No newline at end of file
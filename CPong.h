@@ -1,6 +1,9 @@
 #pragma once
 
 #include "CBase4618.h"
+#include "CRingBuffer.h"
+#include "CTextRenderer.h"
+#include "CSpriteCache.h"
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
@@ -77,9 +80,20 @@ public:
      *  - FPS
      *  - Settings panel
      *  - Game over message (if active)
+     *
+     * During play only the bounding boxes drawn into the back buffer two
+     * frames ago are erased, and the boxes of the last and current frame are
+     * reported as damage. The whole canvas is cleared while the settings
+     * panel or game over message is shown.
+     *
+     * The game is drawn into _world with palette pens, so it also runs
+     * with the 8-bit indexed world.
      */
     void draw();
 
+    /** @brief Draws the cvui settings button and panel on the resolved canvas. */
+    void draw_overlay();
+
     /**
      * @brief Resets the entire game state.
      *
@@ -102,17 +116,30 @@ private:
     /** @brief Update loop timing, pacing, and FPS measurements. */
     void update_timing();
 
-    /** @brief Checks collision between ball and walls. */
-    void check_wall_collision();
+    /**
+     * @brief Advances ball and paddles by one fixed physics step.
+     *
+     * Saves the current positions first, so draw_game() can interpolate.
+     *
+     * @param dt Step length (seconds)
+     */
+    void step(float dt);
 
-    /** @brief Checks collision between ball and paddles. */
-    void check_paddle_collision();
+    /** @brief Scores a point when the ball reaches the left or right wall. */
+    void check_wall_collision();
 
     /** @brief Handles toggle event for settings window. */
     void handle_settings_event();
 
     /**
-     * @brief Updates ball position based on velocity and delta time.
+     * @brief Moves the ball through one step, bouncing off walls and paddles.
+     *
+     * The ball is swept along its path rather than tested where it lands:
+     * the step is cut at each time of impact with a wall or paddle face,
+     * the velocity is reflected there and the rest of the step continues
+     * from the contact point. A ball that covers more than a paddle's
+     * width per step still bounces. Time still left after MAX_BOUNCES
+     * impacts is carried into the next step rather than dropped.
      *
      * @param dt Delta time (seconds)
      */
@@ -133,12 +160,37 @@ private:
     /** @brief Draws ball, paddles, score, and FPS. */
     void draw_game();
 
-    /** @brief Draws static UI elements such as buttons. */
+    /** @brief Draws the score and FPS text. */
     void draw_ui();
 
     /** @brief Draws the settings control panel. */
     void draw_settings_panel();
 
+    /**
+     * @brief Records a region drawn this frame for dirty-rectangle erase.
+     *
+     * @param r Drawn region; padded slightly and clipped to the canvas
+     */
+    void add_box(const cv::Rect& r);
+
+    /**
+     * @brief Draws a line of HUD text and records its bounding box.
+     *
+     * @param text Text to draw
+     * @param org Bottom-left corner of the text (as cv::putText)
+     */
+    void draw_text(const char* text, cv::Point org);
+
+    /**
+     * @brief Draws a settings label the way cvui::text would.
+     *
+     * @param im Canvas to draw on
+     * @param x Left edge of the label
+     * @param y Top edge of the label
+     * @param text Label text
+     */
+    void draw_label(cv::Mat& im, int x, int y, const char* text);
+
     // ------------------------------------------------------------------
     // Hardware and Game State
     // ------------------------------------------------------------------
@@ -154,14 +206,26 @@ private:
     // ------------------------------------------------------------------
 
     cv::Size _size;           ///< Canvas dimensions
-    cv::Mat _canvas;          ///< Frame buffer for rendering
-    std::string _window_name; ///< OpenCV window title
+
+    std::vector<cv::Rect> _boxes;    ///< Regions drawn this frame
+    std::vector<cv::Rect> _drawn[2]; ///< Regions drawn into each swap chain buffer
+    int _full_redraw_frames;         ///< Frames left that clear the whole canvas
+
+    CTextRenderer _hud_text{ 1.0, 2 };                 ///< Score and FPS font
+    CTextRenderer _label_text{ 0.4, 1, cv::LINE_AA };  ///< Settings label font (cvui::text style)
+    CSpriteCache _sprites;    ///< Ball sprite, one per radius set in the settings
+
+    int _layer_button;        ///< Cached SETTINGS button, keyed by its hover state
+    int _layer_panel;         ///< Cached settings window frame and labels
+    int _layer_game_over;     ///< Cached game over banner
 
     // ------------------------------------------------------------------
     // Ball State
     // ------------------------------------------------------------------
 
     cv::Point2f _ball_pos;    ///< Ball position (floating point precision)
+    cv::Point2f _ball_prev;   ///< Ball position before the last physics step
+    float _sweep_carry;       ///< Sweep time the last step had no impacts left for (seconds)
     cv::Point2f _ball_vel;    ///< Ball velocity (pixels per second)
     int _ball_radius;         ///< Ball radius (pixels)
     int _ball_speed;          ///< Ball speed magnitude (pixels per second)
@@ -172,6 +236,8 @@ private:
 
     cv::Rect _left_paddle;    ///< Left paddle rectangle
     cv::Rect _right_paddle;   ///< Right paddle rectangle
+    int _left_prev_y;         ///< Left paddle y before the last physics step
+    int _right_prev_y;        ///< Right paddle y before the last physics step
 
     // ------------------------------------------------------------------
     // Score
@@ -187,9 +253,9 @@ private:
     double _last_time;   ///< Last frame timestamp (seconds)
     double _fps;         ///< Current measured FPS
 
-    std::vector<double> _fps_history;  ///< vector storing fps history
+    CRingBuffer<double> _fps_history;  ///< fixed-size fps history
     double _fps_sum;                   ///< sum of all the FPS(s)
     size_t _max_samples;               ///< Number of samples for averaging
     double _avg_fps;                   ///< Average FPS
-    double _target_dt;                   ///< the time each loop should take
+    double _target_dt;                   ///< the time each drawn frame should take
 };
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "stdafx.h"
+#include "CPongBatch.h"
+#include <algorithm>
+#include <cmath>
+
+#define WIN_SCORE 5         // points that end a match
+#define NO_IMPACT 1.0e30f   // time of impact for a plane that is never reached
+
+// One xorshift32 step; the state must not be zero
+static inline uint32_t xorshift32(uint32_t s)
+{
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+// Per-step constants shared by every match
+struct StepParams
+{
+    float dt;          // step length (seconds)
+    float top;         // planes the ball centre bounces off: the walls and
+    float bottom;      // paddle faces pushed in by the ball radius
+    float left_face;
+    float right_face;
+    float paddle_h;    // paddle height
+    float max_y;       // lowest paddle top edge
+    float width;       // board width
+    float radius;      // ball radius
+    float cx;          // serve position
+    float cy;
+    float component;   // serve velocity per axis
+};
+
+// Advances one ball to its next impact or the end of the step, as one round of the
+// sweep in CPong::update_ball. A zero velocity gives an infinite or NaN time and a
+// plane already passed gives a negative one; the comparisons reject both. A ball
+// with no time left moves by zero.
+static inline void sweep_once(float& px, float& py, float& dx, float& dy, float& left,
+    float ly, float ry, const StepParams& p)
+{
+    float wall = dy < 0.0f ? p.top : p.bottom;
+    float t_wall = (wall - py) / dy;
+    t_wall = t_wall >= 0.0f ? t_wall : NO_IMPACT;
+
+    float face = dx < 0.0f ? p.left_face : p.right_face;
+    float pad_y = dx < 0.0f ? ly : ry;
+    float t_pad = (face - px) / dx;
+    float hit_y = py + dy * t_pad;
+    t_pad = t_pad >= 0.0f ? t_pad : NO_IMPACT;
+    t_pad = hit_y >= pad_y ? t_pad : NO_IMPACT;
+    t_pad = hit_y <= pad_y + p.paddle_h ? t_pad : NO_IMPACT;
+
+    // Which surface is reached first, kept as flags; a paddle wins a tie with the wall
+    bool hit_pad = (t_pad <= left) & (t_pad <= t_wall);
+    bool hit_wall = !hit_pad & (t_wall <= left);
+    float t = hit_pad ? t_pad : (hit_wall ? t_wall : left);
+
+    px += dx * t;
+    py += dy * t;
+    left -= t;
+
+    px = hit_pad ? face : px;
+    py = hit_wall ? wall : py;
+    dx = hit_pad ? -dx : dx;
+    dy = hit_wall ? -dy : dy;
+}
+
+// Steps matches [begin, end). The arrays are restrict parameters, not members, so
+// the compiler knows they do not overlap and needs no runtime aliasing checks.
+// Every field is loaded once, updated in registers and stored once; the branches
+// of CPong become selects and every store is unconditional, so the loop is
+// written to be vectorizable (GCC -O3 still keeps it scalar).
+static void step_matches(const StepParams p, int begin, int end,
+    float* __restrict x, float* __restrict y, float* __restrict vx, float* __restrict vy,
+    float* __restrict left_y, float* __restrict right_y, const float* __restrict speed,
+    float* __restrict carry, uint32_t* __restrict rng, int* __restrict score_left, int* __restrict score_right,
+    int* __restrict wins_left, int* __restrict wins_right)
+{
+    for (int i = begin; i < end; i++)
+    {
+        float px = x[i];
+        float py = y[i];
+        float dx = vx[i];
+        float dy = vy[i];
+
+        // Up to four impacts per step against the paddles where the last step
+        // left them, as CPong::update_ball. Written out rather than looped so
+        // the body stays one straight block.
+        float ly = left_y[i];
+        float ry = right_y[i];
+        float left = p.dt + carry[i];
+        sweep_once(px, py, dx, dy, left, ly, ry, p);
+        sweep_once(px, py, dx, dy, left, ly, ry, p);
+        sweep_once(px, py, dx, dy, left, ly, ry, p);
+        sweep_once(px, py, dx, dy, left, ly, ry, p);
+
+        // Then the paddles (CPong::update_left_paddle, and a tracker for the right one)
+        float target = py - p.paddle_h / 2.0f;
+        ly = std::min(std::max(target, 0.0f), p.max_y);
+        float d = std::min(std::max(target - ry, -speed[i]), speed[i]);
+        ry = std::min(std::max(ry + d, 0.0f), p.max_y);
+
+        // Side walls score and serve again (CPong::check_wall_collision, CPong::reset_ball)
+        bool left_out = px - p.radius <= 0.0f;
+        bool right_out = px + p.radius >= p.width;
+        bool scored = left_out | right_out;
+
+        // The generator only advances on a serve, as rand() does in CPong
+        uint32_t s = rng[i];
+        uint32_t next = xorshift32(s);
+        s = scored ? next : s;
+
+        px = scored ? p.cx : px;
+        py = scored ? p.cy : py;
+        dx = scored ? ((next & 1) ? p.component : -p.component) : dx;
+        dy = scored ? ((next & 2) ? p.component : -p.component) : dy;
+
+        int sl = score_left[i] + (int)right_out;
+        int sr = score_right[i] + (int)left_out;
+        bool left_won = sl >= WIN_SCORE;
+        bool right_won = sr >= WIN_SCORE;
+        bool over = left_won | right_won;
+
+        x[i] = px;
+        y[i] = py;
+        vx[i] = dx;
+        vy[i] = dy;
+        left_y[i] = ly;
+        right_y[i] = ry;
+        carry[i] = scored ? 0.0f : std::min(left, p.dt);
+        rng[i] = s;
+        score_left[i] = over ? 0 : sl;
+        score_right[i] = over ? 0 : sr;
+        wins_left[i] += (int)left_won;
+        wins_right[i] += (int)right_won;
+    }
+}
+
+CPongBatch::CPongBatch(size_t count, cv::Size board, uint32_t seed, float paddle_speed)
+{
+    _count = count;
+    _board = board;
+
+    // Same dimensions as CPong's defaults
+    _radius = 20.0f;
+    _speed = 1000.0f;
+    _paddle_w = 20.0f;
+    _paddle_h = 150.0f;
+    _left_x = 40.0f;
+    _right_x = board.width - 40.0f - _paddle_w;
+
+    _ball_x.resize(count);
+    _ball_y.resize(count);
+    _vel_x.resize(count);
+    _vel_y.resize(count);
+    _left_y.assign(count, (board.height - _paddle_h) / 2.0f);
+    _right_y.assign(count, (board.height - _paddle_h) / 2.0f);
+    _right_speed.assign(count, paddle_speed);
+    _carry.assign(count, 0.0f);
+    _rng.resize(count);
+    _score_left.assign(count, 0);
+    _score_right.assign(count, 0);
+    _wins_left.assign(count, 0);
+    _wins_right.assign(count, 0);
+
+    float component = _speed / std::sqrt(2.0f);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        // Spread the seed over the matches; a few rounds decorrelate neighbours
+        uint32_t s = seed ^ ((uint32_t)(i + 1) * 0x9E3779B9u);
+        if (s == 0)
+            s = 1;
+        for (int k = 0; k < 4; k++)
+            s = xorshift32(s);
+        _rng[i] = s;
+
+        _ball_x[i] = board.width / 2.0f;
+        _ball_y[i] = board.height / 2.0f;
+        _vel_x[i] = (s & 1) ? component : -component;
+        _vel_y[i] = (s & 2) ? component : -component;
+    }
+}
+
+void CPongBatch::step(float dt, cv::Range r)
+{
+    StepParams p;
+    p.dt = dt;
+    p.top = _radius;
+    p.bottom = _board.height - _radius;
+    p.left_face = _left_x + _paddle_w + _radius;
+    p.right_face = _right_x - _radius;
+    p.paddle_h = _paddle_h;
+    p.max_y = _board.height - _paddle_h;
+    p.width = (float)_board.width;
+    p.radius = _radius;
+    p.cx = _board.width / 2.0f;
+    p.cy = _board.height / 2.0f;
+    p.component = _speed / std::sqrt(2.0f);
+
+    step_matches(p, r.start, r.end,
+        _ball_x.data(), _ball_y.data(), _vel_x.data(), _vel_y.data(),
+        _left_y.data(), _right_y.data(), _right_speed.data(),
+        _carry.data(), _rng.data(), _score_left.data(), _score_right.data(),
+        _wins_left.data(), _wins_right.data());
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "CAlignedAllocator.h"
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file CPongBatch.h
+ * @brief Many independent headless Pong matches stepped together.
+ */
+
+ /**
+  * @class CPongBatch
+  * @brief Steps the ball and paddles of N Pong matches as array kernels.
+  *
+  * Each match is the CPong rally without a window: the ball is swept
+  * against the walls and paddle faces as in CPong::update_ball(), the left
+  * paddle follows the ball as in CPong::update_left_paddle(), and a ball
+  * reaching the left or right wall scores and is served again as in
+  * CPong::check_wall_collision(). The right paddle is played by a tracker
+  * that moves toward the ball at a per-match speed, which is the parameter
+  * to tune. A match ends at 5 points; the winner is counted and the next
+  * match starts at once.
+  *
+  * Every field is stored in its own array across matches, and a step is a
+  * single loop over them whose body has no branches, written to be
+  * vectorizable across matches. GCC still reports control flow in it and
+  * keeps it scalar, so any gain over CPong comes from the layout, not
+  * SIMD. Each match serves from its own xorshift32 generator rather than
+  * the shared rand(), so matches do not depend on each other or on the
+  * order they are stepped in, and disjoint ranges can be stepped on
+  * several threads at once (see parallel_chunks()).
+  *
+  * The ball speed never changes during a rally, so the velocity is not
+  * renormalized every step as CPong does after a settings change.
+  */
+class CPongBatch
+{
+private:
+    CAlignedVector<float> _ball_x;      ///< Ball position x
+    CAlignedVector<float> _ball_y;      ///< Ball position y
+    CAlignedVector<float> _vel_x;       ///< Ball velocity x (pixels per second)
+    CAlignedVector<float> _vel_y;       ///< Ball velocity y (pixels per second)
+    CAlignedVector<float> _left_y;      ///< Left paddle top edge
+    CAlignedVector<float> _right_y;     ///< Right paddle top edge
+    CAlignedVector<float> _right_speed; ///< Right paddle speed (pixels per step)
+    CAlignedVector<float> _carry;       ///< Sweep time left over after four impacts (seconds)
+    CAlignedVector<uint32_t> _rng;      ///< xorshift32 state for serves
+    CAlignedVector<int> _score_left;    ///< Left score in the current match
+    CAlignedVector<int> _score_right;   ///< Right score in the current match
+    CAlignedVector<int> _wins_left;     ///< Matches won by the left paddle
+    CAlignedVector<int> _wins_right;    ///< Matches won by the right paddle
+
+    size_t _count;       ///< Matches in the batch
+    cv::Size _board;     ///< Board size shared by all matches
+    float _radius;       ///< Ball radius
+    float _speed;        ///< Ball speed (pixels per second)
+    float _paddle_w;     ///< Paddle width
+    float _paddle_h;     ///< Paddle height
+    float _left_x;       ///< Left paddle left edge
+    float _right_x;      ///< Right paddle left edge
+
+public:
+    /**
+     * @brief Creates the matches with CPong's ball and paddle dimensions.
+     *
+     * @param count Number of matches
+     * @param board Board size
+     * @param seed Seed for the per-match serve generators
+     * @param paddle_speed Initial right paddle speed (pixels per step)
+     */
+    CPongBatch(size_t count, cv::Size board = cv::Size(1000, 800), uint32_t seed = 4618, float paddle_speed = 15.0f);
+
+    /// @brief Number of matches.
+    size_t size() const { return _count; }
+
+    /// @brief Sets the right paddle speed of match i in pixels per step.
+    void set_paddle_speed(size_t i, float speed) { _right_speed[i] = speed; }
+
+    /**
+     * @brief Advances a range of matches by one physics step.
+     *
+     * @param dt Step length in seconds
+     * @param r Matches to step
+     */
+    void step(float dt, cv::Range r);
+
+    /// @brief Advances every match by one physics step.
+    void step(float dt) { step(dt, cv::Range(0, (int)_count)); }
+
+    /// @brief Ball position of match i.
+    cv::Point2f get_ball(size_t i) const { return cv::Point2f(_ball_x[i], _ball_y[i]); }
+
+    /// @brief Matches won by the left paddle in slot i.
+    int get_wins_left(size_t i) const { return _wins_left[i]; }
+
+    /// @brief Matches won by the right paddle in slot i.
+    int get_wins_right(size_t i) const { return _wins_right[i]; }
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+/**
+ * @file CRingBuffer.h
+ * @brief Fixed-capacity circular history buffer.
+ */
+
+ /**
+  * @class CRingBuffer
+  * @brief Stores the most recent samples in preallocated storage.
+  *
+  * Storage is allocated once by set_capacity(). Pushing into a full buffer
+  * overwrites the oldest sample, so no memory is allocated or moved per push.
+  * Index 0 is always the oldest sample and size() - 1 the newest.
+  *
+  * @tparam T Sample type.
+  */
+template <typename T>
+class CRingBuffer
+{
+private:
+    std::vector<T> _data; ///< Preallocated sample storage
+    size_t _start;        ///< Index of the oldest sample in _data
+    size_t _count;        ///< Number of valid samples
+
+public:
+    /**
+     * @brief Constructs a buffer holding up to capacity samples.
+     *
+     * @param capacity Maximum number of samples kept
+     */
+    CRingBuffer(size_t capacity = 1) : _data(capacity > 0 ? capacity : 1), _start(0), _count(0) {}
+
+    /**
+     * @brief Reallocates the storage and clears all samples.
+     *
+     * @param capacity Maximum number of samples kept
+     */
+    void set_capacity(size_t capacity)
+    {
+        _data.assign(capacity > 0 ? capacity : 1, T());
+        clear();
+    }
+
+    /** @brief Discards all samples without releasing storage. */
+    void clear() { _start = 0; _count = 0; }
+
+    /**
+     * @brief Appends a sample, overwriting the oldest one when full.
+     *
+     * @param value Sample to store
+     */
+    void push(const T& value)
+    {
+        if (_count < _data.size())
+        {
+            _data[(_start + _count) % _data.size()] = value;
+            _count++;
+        }
+        else
+        {
+            _data[_start] = value;
+            _start = (_start + 1) % _data.size();
+        }
+    }
+
+    /// @brief Get a sample in chronological order.
+    /// @param i 0 for the oldest sample, size() - 1 for the newest.
+    /// @return Reference to the sample.
+    const T& operator[](size_t i) const { return _data[(_start + i) % _data.size()]; }
+
+    /// @brief Get the oldest sample. Buffer must not be empty.
+    const T& front() const { return _data[_start]; }
+
+    /// @brief Get the newest sample. Buffer must not be empty.
+    const T& back() const { return (*this)[_count - 1]; }
+
+    /// @brief Number of valid samples.
+    size_t size() const { return _count; }
+
+    /// @brief Maximum number of samples.
+    size_t capacity() const { return _data.size(); }
+
+    /// @brief True if no samples are stored.
+    bool empty() const { return _count == 0; }
+
+    /// @brief True if the next push overwrites the oldest sample.
+    bool full() const { return _count == _data.size(); }
+
+    /**
+     * @brief Copies the samples into out in chronological order.
+     *
+     * out keeps its storage between calls, so after the first call with a
+     * full buffer this does not allocate.
+     *
+     * @param out Destination vector, resized to size()
+     */
+    void copy_to(std::vector<T>& out) const
+    {
+        out.resize(_count);
+
+        size_t first = _data.size() - _start;
+        if (first > _count)
+            first = _count;
+
+        std::copy(_data.begin() + _start, _data.begin() + _start + first, out.begin());
+        std::copy(_data.begin(), _data.begin() + (_count - first), out.begin() + first);
+    }
+};
@@ -22,10 +22,17 @@ void CShip::move(double dt)
 void CShip::draw(Mat& im)
 {
     Point2f tip( _position.x + 20 * cos(_angle), _position.y + 20 * sin(_angle));
-    circle(im, _position, _radius, Scalar(255, 255, 255), 1);
+    _sprites.stamp_circle(im, _position, _radius, Scalar(255, 255, 255), 1);
     line(im, _position, tip, Scalar(255, 255, 255), 2);
 }
 
+void CShip::draw(CDrawList& list, const Scalar& color)
+{
+    Point2f tip( _position.x + 20 * cos(_angle), _position.y + 20 * sin(_angle));
+    list.circle(_position, _radius, color, 1);
+    list.line(_position, tip, color, 2);
+}
+
 void CShip::thrust(Point2f accel, double dt)
 {
     _velocity += accel * dt;
@@ -1,16 +1,16 @@
 #pragma once
-#include "CGameObject.h"
+#include "CEntity.h"
 
 /**
  * @class CShip
  * @brief Represents the player controlled spaceship.
  *
- * CShip inherits from CGameObject.
+ * CShip inherits from CGameObject through CEntity.
  * The ship accelerates based on joystick input,
  * has a maximum speed limit, and always faces
  * the direction of movement.
  */
-class CShip : public CGameObject
+class CShip : public CEntity<CShip>
 {
 public:
 
@@ -35,6 +35,14 @@ public:
      */
     void draw(Mat& im);
 
+    /**
+     * @brief Submit ship graphics to a frame draw list.
+     *
+     * @param list Draw list for the current frame.
+     * @param color Ship colour, or a palette index for an indexed world.
+     */
+    void draw(CDrawList& list, const Scalar& color = Scalar(255, 255, 255));
+
     /**
      * @brief Apply acceleration to the ship.
      *
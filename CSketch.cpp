@@ -22,6 +22,16 @@
 
 #define WINDOW_NAME "Etch-A-Sketch"
 
+#define CURSOR_RADIUS  3
+#define STROKE_WIDTH   2
+#define MAX_STROKE_DAMAGE 64   // pending rects per buffer before a full copy
+
+// Button strip in window coordinates
+#define UI_STRIP_W 230
+#define UI_STRIP_H 50
+static const cv::Rect CLEAR_BUTTON(10, 10, 100, 30);
+static const cv::Rect EXIT_BUTTON(120, 10, 100, 30);
+
 //////////////////////
 /// Color constants
 //////////////////////
@@ -38,29 +48,50 @@ CSketch::CSketch(const cv::Size& canvas_size, int comport)
 {
     _control.init_com(comport);
 
-    _canvas = cv::Mat::zeros(canvas_size, CV_8UC3);     // Initialize canvas (color image)
+    create_canvas(canvas_size);     // Initialize swap chain (color image)
+    _strokes = cv::Mat::zeros(canvas_size, CV_8UC3);     // Lines survive buffer flips here
+    _stroke_damage[0].reserve(MAX_STROKE_DAMAGE);
+    _stroke_damage[1].reserve(MAX_STROKE_DAMAGE);
 
+    _window_name = WINDOW_NAME;
     cv::namedWindow(WINDOW_NAME);     // Create display window
 
     //GUI buttons set up
     cvui::init(WINDOW_NAME);
 
+    // Rendered once here, then only while the mouse is over the strip
+    _ui = cv::Mat::zeros(UI_STRIP_H, UI_STRIP_W, CV_8UC3);
+    cvui::button(_ui, CLEAR_BUTTON.x, CLEAR_BUTTON.y, CLEAR_BUTTON.width, CLEAR_BUTTON.height, "CLEAR");
+    cvui::button(_ui, EXIT_BUTTON.x, EXIT_BUTTON.y, EXIT_BUTTON.width, EXIT_BUTTON.height, "EXIT");
+    _ui_hot = false;
+
     _current_pos = cv::Point(canvas_size.width / 2, canvas_size.height / 2);
     _prev_pos = _current_pos;
 
     _color_index = 0;
     _joy_y_pct = 50;
     _joy_x_pct = 50;
+    _latch_channels.push_back(JOYSTICK_X);
+    _latch_channels.push_back(JOYSTICK_Y);
     _last_shake_time = 0.0;
 
     _color_change_event = false;
     _reset_event = false;
 
     set_led_for_color();
+
+    // Back off to a low refresh rate while the joystick is centred
+    set_idle_policy(true);
 }
 
 void CSketch::update(){
-    
+
+    // CLEAR is clicked in draw(); the event is logged here, where replays read it
+    _reset_event = log_action(_reset_event);
+
+    // Cursor position is the latency-critical use of the joystick
+    latch_analog(JOYSTICK_X, _joy_x_pct);
+    latch_analog(JOYSTICK_Y, _joy_y_pct);
     // Joystick centered at 50%
     double dx = _joy_x_pct - 50.0;
     double dy = _joy_y_pct - 50.0;
@@ -93,13 +124,26 @@ void CSketch::update(){
     else if (_current_pos.y >= _canvas.rows)
     _current_pos.y = _canvas.rows - 1;
 
+    // Trace the samples the cursor reacted to
+    if (_current_pos.x != _prev_pos.x)
+        tag_frame(_control.get_input_tag(ANALOG, JOYSTICK_X));
+    if (_current_pos.y != _prev_pos.y)
+        tag_frame(_control.get_input_tag(ANALOG, JOYSTICK_Y));
+
+    // Only cursor movement or an event changes the picture
+    if (_current_pos != _prev_pos || _reset_event || _color_change_event)
+        _frame_changed = true;
+
     // Draw line
-    cv::line(_canvas, _prev_pos, _current_pos, DRAW_COLORS[_color_index], 2);
+    cv::line(_strokes, _prev_pos, _current_pos, DRAW_COLORS[_color_index], STROKE_WIDTH);
+    if (_current_pos != _prev_pos)
+        add_stroke_damage(cv::Rect(_prev_pos, _current_pos));
 
     // resseting the canvas
     if (_reset_event)
     {
-        _canvas = cv::Mat::zeros(_canvas.size(), CV_8UC3);
+        _strokes.setTo(cv::Scalar(0, 0, 0));
+        add_stroke_damage(cv::Rect(0, 0, _strokes.cols, _strokes.rows));
 
         _prev_pos = _current_pos;
         _reset_event = false;
@@ -115,22 +159,84 @@ void CSketch::update(){
     }    
 }
 
+void CSketch::add_stroke_damage(const cv::Rect& r)
+{
+    cv::Rect canvas_rect(0, 0, _strokes.cols, _strokes.rows);
+    cv::Rect padded(r.x - STROKE_WIDTH, r.y - STROKE_WIDTH,
+        r.width + 2 * STROKE_WIDTH + 1, r.height + 2 * STROKE_WIDTH + 1);
+    cv::Rect box = padded & canvas_rect;
+
+    for (int i = 0; i < 2; i++)
+    {
+        // Too many small copies: one full copy is cheaper
+        if (_stroke_damage[i].size() >= MAX_STROKE_DAMAGE)
+        {
+            _stroke_damage[i].clear();
+            _stroke_damage[i].push_back(canvas_rect);
+        }
+        else
+        {
+            _stroke_damage[i].push_back(box);
+        }
+    }
+}
+
+void CSketch::draw_ui()
+{
+    cv::Rect strip(0, 0, UI_STRIP_W, UI_STRIP_H);
+    bool hot = strip.contains(cvui::mouse());
+
+    // Hover, press and click only happen over the strip; render once more on leaving
+    if (hot || _ui_hot)
+    {
+        if (cvui::button(_ui, CLEAR_BUTTON.x, CLEAR_BUTTON.y, CLEAR_BUTTON.width, CLEAR_BUTTON.height, "CLEAR"))
+            _reset_event = true;
+
+        if (cvui::button(_ui, EXIT_BUTTON.x, EXIT_BUTTON.y, EXIT_BUTTON.width, EXIT_BUTTON.height, "EXIT"))
+            _exit = true;
+    }
+    _ui_hot = hot;
+
+    // Only the buttons are opaque; strokes stay visible between them
+    _ui(CLEAR_BUTTON).copyTo(_canvas(CLEAR_BUTTON));
+    _ui(EXIT_BUTTON).copyTo(_canvas(EXIT_BUTTON));
+    add_damage(CLEAR_BUTTON);
+    add_damage(EXIT_BUTTON);
+}
+
 void CSketch::draw(){
-    cv::Mat display = _canvas.clone();
+    int back = _back_buffer;
 
-    // Cursor
-    cv::circle(display,_current_pos, 3, DRAW_COLORS[_color_index], -1);
+    // The HUD is drawn over the buffer at present time; repaint under it
+    // every frame, so both buffers are clean again once it is hidden
+    if (_perf_hud.is_visible())
+        add_stroke_damage(_perf_hud.get_rect(_canvas.size()));
 
-    // GUI buttons
-    if (cvui::button(display, 10, 10, 100, 30, "CLEAR"))
-        _reset_event = true;
+    // Strokes drawn since this buffer was last shown
+    for (const cv::Rect& r : _stroke_damage[back])
+    {
+        _strokes(r).copyTo(_canvas(r));
+        add_damage(r);
+    }
+    _stroke_damage[back].clear();
 
-    if (cvui::button(display, 120, 10, 100, 30, "EXIT"))
-        _exit = true;
-    
+    // Restore what was under the cursor from the stroke layer
+    cv::Rect old_cursor = _cursor_box[back];
+    if (!old_cursor.empty())
+        _strokes(old_cursor).copyTo(_canvas(old_cursor));
 
-    cvui::update(WINDOW_NAME);
-    cv::imshow(WINDOW_NAME, display);
+    // Cursor
+    cv::Rect cursor(_current_pos.x - CURSOR_RADIUS, _current_pos.y - CURSOR_RADIUS,
+        2 * CURSOR_RADIUS + 1, 2 * CURSOR_RADIUS + 1);
+    _cursor_box[back] = cursor & cv::Rect(0, 0, _canvas.cols, _canvas.rows);
+    cv::circle(_canvas,_current_pos, CURSOR_RADIUS, DRAW_COLORS[_color_index], -1);
+
+    // The frame on screen has its cursor in the other buffer's box
+    add_damage(_cursor_box[back ^ 1]);
+    add_damage(_cursor_box[back]);
+
+    // GUI buttons
+    draw_ui();
 }
 
 void CSketch::gpio() {
@@ -31,6 +31,23 @@ private:
     bool   _color_change_event; ///< True when a debounced button press is detected
     bool _reset_event;    ///< Clear canvas request
     double _last_shake_time;   ///< Last shake timestamp
+    cv::Mat _strokes;     ///< Persistent stroke layer; also the save-under for the cursor
+    std::vector<cv::Rect> _stroke_damage[2]; ///< Stroke regions not yet copied into each buffer
+    cv::Rect _cursor_box[2]; ///< Cursor region drawn into each buffer
+    cv::Mat _ui;          ///< Cached button strip, positioned at the window origin
+    bool _ui_hot;         ///< True if the strip was re-rendered for the mouse last frame
+
+    /**
+     * @brief Marks a region of the stroke layer as changed in both buffers.
+     *
+     * @param r Changed region of _strokes
+     */
+    void add_stroke_damage(const cv::Rect& r);
+
+    /**
+     * @brief Re-renders the button strip when the mouse is over it and blits the buttons.
+     */
+    void draw_ui();
 
 public:
     /**
@@ -74,7 +91,9 @@ public:
     /**
      * @brief Draws the current application state to the canvas.
      *
-     * Renders the canvas contents and any GUI elements.
+     * Renders the canvas contents and any GUI elements. Only stroke regions
+     * the back buffer has not received yet, the old and new cursor and the
+     * buttons are copied, so the cost does not depend on the canvas size.
      */
     void draw();  //OVERRIDE
 
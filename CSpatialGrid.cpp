@@ -0,0 +1,42 @@
+#include "stdafx.h"
+#include "CSpatialGrid.h"
+
+CSpatialGrid::CSpatialGrid(int cell_size)
+{
+    _cell_size = cell_size > 0 ? cell_size : 128;
+    _cols = 1;
+    _rows = 1;
+    _max_radius = 0.0f;
+}
+
+void CSpatialGrid::build(const CEntityStore& store, cv::Size bounds)
+{
+    _cols = std::max(1, (bounds.width + _cell_size - 1) / _cell_size);
+    _rows = std::max(1, (bounds.height + _cell_size - 1) / _cell_size);
+
+    int cells = _cols * _rows;
+    int n = (int)store.size();
+
+    _cell_start.assign(cells + 1, 0);
+    _cell_of.resize(n);
+    _items.resize(n);
+    _max_radius = 0.0f;
+
+    // Count per cell, shifted by one so the prefix sum yields start offsets
+    for (int i = 0; i < n; i++)
+    {
+        cv::Point2f pos = store.get_pos(i);
+        int cell = row(pos.y) * _cols + col(pos.x);
+
+        _cell_of[i] = cell;
+        _cell_start[cell + 1]++;
+        _max_radius = std::max(_max_radius, store.get_radius(i));
+    }
+
+    for (int c = 0; c < cells; c++)
+        _cell_start[c + 1] += _cell_start[c];
+
+    _cursor.assign(_cell_start.begin(), _cell_start.end() - 1);
+    for (int i = 0; i < n; i++)
+        _items[_cursor[_cell_of[i]]++] = i;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "CEntityStore.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <vector>
+
+/**
+ * @file CSpatialGrid.h
+ * @brief Uniform grid broadphase for circle collisions.
+ */
+
+ /**
+  * @class CSpatialGrid
+  * @brief Buckets entities by cell so collision queries only visit nearby ones.
+  *
+  * build() sorts an entity store into square cells with a counting sort:
+  * one pass counts entities per cell, a prefix sum turns the counts into
+  * offsets, and a second pass writes the entity indices grouped by cell into
+  * one flat array. Nothing is allocated once the arrays have grown to the
+  * largest count seen.
+  *
+  * Each entity is filed under the cell of its centre only. A query widens
+  * its circle by the largest radius in the grid, so every entity that can
+  * overlap the query circle is visited exactly once, without deduplication.
+  * Entities outside the bounds are filed in the nearest edge cell.
+  *
+  * The grid only proposes candidates; callers test the returned entities
+  * with CEntityStore::collide().
+  */
+class CSpatialGrid
+{
+private:
+    int _cell_size;               ///< Cell edge length in pixels
+    int _cols;                    ///< Cells across
+    int _rows;                    ///< Cells down
+    float _max_radius;            ///< Largest radius among the filed entities
+    std::vector<int> _cell_start; ///< Offset of each cell's entities in _items, plus the end
+    std::vector<int> _cursor;     ///< Scratch write offsets while filing
+    std::vector<int> _cell_of;    ///< Cell of each entity
+    std::vector<int> _items;      ///< Entity indices grouped by cell
+
+    /** @brief Column of an x coordinate, clamped to the grid. */
+    int col(float x) const { return std::min(std::max((int)(x / _cell_size), 0), _cols - 1); }
+
+    /** @brief Row of a y coordinate, clamped to the grid. */
+    int row(float y) const { return std::min(std::max((int)(y / _cell_size), 0), _rows - 1); }
+
+    /** @brief Visits every entity filed in the cells of [x0, x1] x [y0, y1]. */
+    template <typename F>
+    void visit_cells(float x0, float y0, float x1, float y1, F& visit) const
+    {
+        int c0 = col(x0);
+        int c1 = col(x1);
+        int r0 = row(y0);
+        int r1 = row(y1);
+
+        for (int r = r0; r <= r1; r++)
+        {
+            for (int c = c0; c <= c1; c++)
+            {
+                int cell = r * _cols + c;
+                for (int k = _cell_start[cell]; k < _cell_start[cell + 1]; k++)
+                    visit((size_t)_items[k]);
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Constructs an empty grid.
+     *
+     * @param cell_size Cell edge length; about twice the typical radius works well
+     */
+    CSpatialGrid(int cell_size = 128);
+
+    /**
+     * @brief Files every entity of a store by its centre.
+     *
+     * Must be called again after the store's entities move or are removed.
+     *
+     * @param store Entities to file
+     * @param bounds Area covered by the grid, from (0, 0)
+     */
+    void build(const CEntityStore& store, cv::Size bounds);
+
+    /**
+     * @brief Visits every filed entity that may overlap a circle.
+     *
+     * @param pos Circle centre
+     * @param radius Circle radius
+     * @param visit Called with the store index of each candidate
+     */
+    template <typename F>
+    void query(cv::Point2f pos, float radius, F visit) const
+    {
+        if (_items.empty())
+            return;
+
+        float reach = radius + _max_radius;
+        visit_cells(pos.x - reach, pos.y - reach, pos.x + reach, pos.y + reach, visit);
+    }
+
+    /**
+     * @brief Visits every filed entity that may overlap a rectangle.
+     *
+     * Used to cull drawing and simulation to a view. Like query(), it
+     * proposes candidates: entities in the cells around the edge may lie
+     * just outside.
+     *
+     * @param area Rectangle in the grid's coordinates
+     * @param visit Called with the store index of each candidate
+     */
+    template <typename F>
+    void query_rect(const cv::Rect2f& area, F visit) const
+    {
+        if (_items.empty())
+            return;
+
+        visit_cells(area.x - _max_radius, area.y - _max_radius,
+            area.x + area.width + _max_radius, area.y + area.height + _max_radius, visit);
+    }
+};
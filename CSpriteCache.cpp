@@ -0,0 +1,114 @@
+#include "stdafx.h"
+#include "CSpriteCache.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cstring>
+
+uint64_t CSpriteCache::make_key(int radius, int thickness, const cv::Scalar& color)
+{
+    uint64_t rgb = ((uint64_t)cv::saturate_cast<uchar>(color[2]) << 16)
+        | ((uint64_t)cv::saturate_cast<uchar>(color[1]) << 8)
+        | (uint64_t)cv::saturate_cast<uchar>(color[0]);
+
+    // Filled circles (thickness < 0) share the thickness value 0
+    uint64_t t = thickness < 0 ? 0 : (uint64_t)(thickness & 0xFF) + 1;
+
+    return ((uint64_t)(radius & 0xFFFF) << 32) | (t << 24) | rgb;
+}
+
+void CSpriteCache::build_circle(Sprite& s, int radius, int thickness, const cv::Scalar& color)
+{
+    s.extent = radius + (thickness > 0 ? thickness : 0) + 1;
+
+    int side = 2 * s.extent + 1;
+    cv::Mat mask = cv::Mat::zeros(side, side, CV_8UC1);
+    cv::circle(mask, cv::Point(s.extent, s.extent), radius, cv::Scalar(255), thickness);
+
+    for (int y = 0; y < side; y++)
+    {
+        const uchar* row = mask.ptr<uchar>(y);
+
+        int x = 0;
+        while (x < side)
+        {
+            while (x < side && row[x] == 0)
+                x++;
+            int start = x;
+            while (x < side && row[x] != 0)
+                x++;
+
+            if (x > start)
+            {
+                Span span = { y - s.extent, start - s.extent, x - s.extent };
+                s.spans.push_back(span);
+            }
+        }
+    }
+
+    s.bgr[0] = cv::saturate_cast<uchar>(color[0]);
+    s.bgr[1] = cv::saturate_cast<uchar>(color[1]);
+    s.bgr[2] = cv::saturate_cast<uchar>(color[2]);
+}
+
+const CSpriteCache::Sprite& CSpriteCache::get_circle(int radius, int thickness, const cv::Scalar& color)
+{
+    uint64_t key = make_key(radius, thickness, color);
+
+    auto it = _sprites.find(key);
+    if (it == _sprites.end())
+    {
+        it = _sprites.emplace(key, Sprite()).first;
+        build_circle(it->second, std::max(radius, 0), thickness, color);
+    }
+    return it->second;
+}
+
+void CSpriteCache::stamp_circle(cv::Mat& im, cv::Point center, int radius, const cv::Scalar& color, int thickness)
+{
+    if ((im.type() == CV_8UC3 || im.type() == CV_8UC1) && radius >= 0)
+        stamp(get_circle(radius, thickness, color), im, center);
+}
+
+bool CSpriteCache::stamp_prepared(cv::Mat& im, cv::Point center, int radius, const cv::Scalar& color, int thickness) const
+{
+    auto it = _sprites.find(make_key(radius, thickness, color));
+    if (it == _sprites.end() || (im.type() != CV_8UC3 && im.type() != CV_8UC1))
+        return false;
+
+    stamp(it->second, im, center);
+    return true;
+}
+
+void CSpriteCache::stamp(const Sprite& s, cv::Mat& im, cv::Point center)
+{
+    // Entirely off the canvas
+    if (center.x + s.extent < 0 || center.x - s.extent >= im.cols ||
+        center.y + s.extent < 0 || center.y - s.extent >= im.rows)
+        return;
+
+    for (const Span& span : s.spans)
+    {
+        int y = center.y + span.y;
+        if (y < 0 || y >= im.rows)
+            continue;
+
+        int x0 = std::max(center.x + span.x0, 0);
+        int x1 = std::min(center.x + span.x1, im.cols);
+
+        // Indexed canvases take the palette index from the first channel
+        if (im.channels() == 1)
+        {
+            if (x1 > x0)
+                std::memset(im.ptr<uchar>(y) + x0, s.bgr[0], x1 - x0);
+            continue;
+        }
+
+        uchar* d = im.ptr<uchar>(y) + 3 * x0;
+        for (int x = x0; x < x1; x++, d += 3)
+        {
+            d[0] = s.bgr[0];
+            d[1] = s.bgr[1];
+            d[2] = s.bgr[2];
+        }
+    }
+}
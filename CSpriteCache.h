@@ -0,0 +1,106 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @file CSpriteCache.h
+ * @brief Pre-rendered circle sprites stamped with clipped span fills.
+ */
+
+ /**
+  * @class CSpriteCache
+  * @brief Rasterizes each circle variant once and stamps it afterwards.
+  *
+  * A sprite is keyed by radius, thickness and colour. The first request for
+  * a key draws the circle once with cv::circle into a small mask and stores
+  * it as horizontal runs of covered pixels. Every later stamp clips the runs
+  * to the canvas and fills them, so the circle rasterizer never runs again
+  * and an outline only touches the pixels on its ring.
+  *
+  * Stamped pixels are identical to cv::circle with the same parameters and
+  * cv::LINE_8.
+  */
+class CSpriteCache
+{
+private:
+    /**
+     * @brief One horizontal run of covered pixels, relative to the centre.
+     */
+    struct Span
+    {
+        int y;      ///< Row offset from the centre
+        int x0;     ///< First covered column offset
+        int x1;     ///< One past the last covered column offset
+    };
+
+    /**
+     * @brief A cached shape variant.
+     */
+    struct Sprite
+    {
+        std::vector<Span> spans; ///< Covered runs, top to bottom
+        int extent;              ///< Half size of the bounding square
+        uchar bgr[3];            ///< Fill colour
+    };
+
+    std::unordered_map<uint64_t, Sprite> _sprites; ///< Sprites keyed by make_key()
+
+    /** @brief Packs radius, thickness and colour into one key. */
+    static uint64_t make_key(int radius, int thickness, const cv::Scalar& color);
+
+    /** @brief Rasterizes a new circle sprite. */
+    static void build_circle(Sprite& s, int radius, int thickness, const cv::Scalar& color);
+
+    /** @brief Returns the sprite for a circle variant, building it on first use. */
+    const Sprite& get_circle(int radius, int thickness, const cv::Scalar& color);
+
+    /** @brief Fills the clipped runs of a sprite centred at center. */
+    static void stamp(const Sprite& s, cv::Mat& im, cv::Point center);
+
+public:
+    /**
+     * @brief Draws a circle, rasterizing its sprite on first use.
+     *
+     * @param im Canvas to draw on (CV_8UC3, or CV_8UC1 with the index in color[0])
+     * @param center Circle centre
+     * @param radius Circle radius in pixels
+     * @param color Circle colour
+     * @param thickness Outline thickness, or -1 for a filled circle
+     */
+    void stamp_circle(cv::Mat& im, cv::Point center, int radius, const cv::Scalar& color, int thickness = 1);
+
+    /**
+     * @brief Builds the sprite for a circle variant without drawing it.
+     *
+     * Used before stamp_prepared() is called from several threads.
+     *
+     * @param radius Circle radius in pixels
+     * @param color Circle colour
+     * @param thickness Outline thickness, or -1 for a filled circle
+     */
+    void prepare_circle(int radius, const cv::Scalar& color, int thickness = 1) { get_circle(radius, thickness, color); }
+
+    /**
+     * @brief Draws a circle whose sprite was built by prepare_circle().
+     *
+     * Only reads the cache, so it is safe to call from several threads at
+     * once. Does nothing if the variant has not been prepared.
+     *
+     * @param im Canvas to draw on (CV_8UC3, or CV_8UC1 with the index in color[0])
+     * @param center Circle centre
+     * @param radius Circle radius in pixels
+     * @param color Circle colour
+     * @param thickness Outline thickness, or -1 for a filled circle
+     * @return true if the variant was cached and stamped
+     */
+    bool stamp_prepared(cv::Mat& im, cv::Point center, int radius, const cv::Scalar& color, int thickness = 1) const;
+
+    /// @brief Number of cached sprite variants.
+    size_t size() const { return _sprites.size(); }
+
+    /** @brief Discards all cached sprites. */
+    void clear() { _sprites.clear(); }
+};
@@ -0,0 +1,146 @@
+#include "stdafx.h"
+#include "CTextRenderer.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cstring>
+
+#define FIRST_GLYPH ' '
+#define LAST_GLYPH  '~'
+#define GLYPH_COUNT (LAST_GLYPH - FIRST_GLYPH + 1)
+#define LAYOUT_CACHE_MAX 256   // cached strings before the cache is flushed
+
+CTextRenderer::CTextRenderer(double scale, int thickness, int line_type, int font_face)
+{
+    _font_face = font_face;
+    _scale = scale;
+    _thickness = thickness;
+    _line_type = line_type;
+
+    _layouts.reserve(LAYOUT_CACHE_MAX);
+    _key.reserve(64);
+
+    build_atlas();
+}
+
+void CTextRenderer::build_atlas()
+{
+    int baseline = 0;
+    cv::Size cap = cv::getTextSize("M", _font_face, _scale, _thickness, &baseline);
+    _height = cap.height;
+
+    // Brackets and accents reach above the cap line; leave half a line of room
+    _pad = _thickness + 2;
+    _origin_y = _pad + _height + _height / 2;
+    _cell_h = _origin_y + baseline + _pad;
+
+    int max_w = 0;
+    for (char c = FIRST_GLYPH; c <= LAST_GLYPH; c++)
+    {
+        char glyph[2] = { c, 0 };
+        max_w = std::max(max_w, cv::getTextSize(glyph, _font_face, _scale, _thickness, &baseline).width);
+    }
+    _cell_w = max_w + 2 * _pad;
+
+    _atlas = cv::Mat::zeros(_cell_h, _cell_w * GLYPH_COUNT, CV_8UC1);
+
+    for (int i = 0; i < GLYPH_COUNT; i++)
+    {
+        char glyph[2] = { (char)(FIRST_GLYPH + i), 0 };
+        cv::Mat cell = _atlas(cv::Rect(i * _cell_w, 0, _cell_w, _cell_h));
+
+        cv::putText(cell, glyph, cv::Point(_pad, _origin_y), _font_face, _scale,
+            cv::Scalar(255), _thickness, _line_type);
+    }
+}
+
+const cv::Mat& CTextRenderer::layout(const char* text)
+{
+    _key.assign(text);
+
+    auto it = _layouts.find(_key);
+    if (it != _layouts.end())
+        return it->second;
+
+    // Changing numbers create a new entry each; flush rather than grow forever
+    if (_layouts.size() >= LAYOUT_CACHE_MAX)
+        _layouts.clear();
+
+    for (char& c : _key)
+    {
+        if (c < FIRST_GLYPH || c > LAST_GLYPH)
+            c = ' ';
+    }
+
+    int baseline = 0;
+    int width = cv::getTextSize(_key, _font_face, _scale, _thickness, &baseline).width;
+    cv::Mat mask = cv::Mat::zeros(_cell_h, width + _cell_w, CV_8UC1);
+
+    for (size_t i = 0; i < _key.size(); i++)
+    {
+        if (_key[i] == ' ')
+            continue;
+
+        // Pen position from the width of the prefix, so rounding matches cv::putText
+        int pen_x = 0;
+        if (i > 0)
+            pen_x = cv::getTextSize(_key.substr(0, i), _font_face, _scale, _thickness, &baseline).width - _thickness;
+
+        int glyph = _key[i] - FIRST_GLYPH;
+        cv::Mat dst = mask(cv::Rect(pen_x, 0, _cell_w, _cell_h));
+        cv::max(dst, _atlas(cv::Rect(glyph * _cell_w, 0, _cell_w, _cell_h)), dst);
+    }
+
+    // Key the cache by the original text, not the sanitized copy
+    return _layouts.emplace(std::string(text), mask).first->second;
+}
+
+cv::Rect CTextRenderer::draw(cv::Mat& im, const char* text, cv::Point org, const cv::Scalar& color)
+{
+    if ((im.type() != CV_8UC3 && im.type() != CV_8UC1) || text == nullptr || text[0] == 0)
+        return cv::Rect();
+
+    const cv::Mat& mask = layout(text);
+
+    cv::Rect area(org.x - _pad, org.y - _origin_y, mask.cols, mask.rows);
+    cv::Rect clipped = area & cv::Rect(0, 0, im.cols, im.rows);
+    if (clipped.empty())
+        return clipped;
+
+    int c[3] = {
+        cv::saturate_cast<uchar>(color[0]),
+        cv::saturate_cast<uchar>(color[1]),
+        cv::saturate_cast<uchar>(color[2])
+    };
+
+    // Palette indices cannot be blended; covered pixels take the index in color[0]
+    if (im.channels() == 1)
+    {
+        for (int y = clipped.y; y < clipped.br().y; y++)
+        {
+            const uchar* m = mask.ptr<uchar>(y - area.y) + (clipped.x - area.x);
+            uchar* d = im.ptr<uchar>(y) + clipped.x;
+
+            for (int x = 0; x < clipped.width; x++)
+                d[x] = m[x] >= 128 ? (uchar)c[0] : d[x];
+        }
+        return clipped;
+    }
+
+    // Branch-free blend over contiguous rows, written so the inner loop can be vectorized
+    for (int y = clipped.y; y < clipped.br().y; y++)
+    {
+        const uchar* m = mask.ptr<uchar>(y - area.y) + (clipped.x - area.x);
+        uchar* d = im.ptr<uchar>(y) + clipped.x * 3;
+
+        for (int x = 0; x < clipped.width; x++)
+        {
+            int a = m[x];
+            int inv = 255 - a;
+            d[3 * x + 0] = (uchar)((d[3 * x + 0] * inv + c[0] * a + 127) / 255);
+            d[3 * x + 1] = (uchar)((d[3 * x + 1] * inv + c[1] * a + 127) / 255);
+            d[3 * x + 2] = (uchar)((d[3 * x + 2] * inv + c[2] * a + 127) / 255);
+        }
+    }
+
+    return clipped;
+}
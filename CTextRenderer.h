@@ -0,0 +1,90 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @file CTextRenderer.h
+ * @brief Cached text drawing for per-frame HUD strings.
+ */
+
+ /**
+  * @class CTextRenderer
+  * @brief Draws text from a pre-rasterized glyph atlas.
+  *
+  * The printable ASCII glyphs are rasterized once with cv::putText into a
+  * single-channel coverage atlas. The first time a string is drawn it is laid
+  * out from the atlas into its own coverage mask, which is cached by content.
+  * Drawing a cached string is then one blend per mask row, so a score or FPS
+  * counter that only changes occasionally costs a few small row copies per
+  * frame instead of re-stroking every Hershey glyph.
+  *
+  * Output matches cv::putText with the same font, scale, thickness and line
+  * type to within a pixel.
+  */
+class CTextRenderer
+{
+private:
+    int _font_face;        ///< Hershey font
+    double _scale;         ///< Font scale
+    int _thickness;        ///< Stroke thickness
+    int _line_type;        ///< cv::LINE_8 or cv::LINE_AA
+
+    cv::Mat _atlas;        ///< Glyph coverage, one cell per printable character (CV_8UC1)
+    int _cell_w;           ///< Width of one atlas cell
+    int _cell_h;           ///< Height of one atlas cell
+    int _pad;              ///< Space left of the glyph origin in a cell
+    int _origin_y;         ///< Baseline row inside a cell
+    int _height;           ///< Text height above the baseline (as cv::getTextSize)
+
+    std::unordered_map<std::string, cv::Mat> _layouts; ///< Laid-out strings keyed by content
+    std::string _key;      ///< Scratch key, reused to avoid allocating per lookup
+
+    /** @brief Rasterizes all printable glyphs into _atlas. */
+    void build_atlas();
+
+    /**
+     * @brief Returns the cached coverage mask of a string, laying it out on first use.
+     *
+     * @param text String to look up
+     * @return Coverage mask; the text origin is at (_pad, _origin_y)
+     */
+    const cv::Mat& layout(const char* text);
+
+public:
+    /**
+     * @brief Builds the glyph atlas for one font configuration.
+     *
+     * @param scale Font scale, as for cv::putText
+     * @param thickness Stroke thickness
+     * @param line_type cv::LINE_8 or cv::LINE_AA
+     * @param font_face Hershey font
+     */
+    CTextRenderer(double scale = 1.0, int thickness = 1, int line_type = cv::LINE_8, int font_face = cv::FONT_HERSHEY_SIMPLEX);
+
+    /**
+     * @brief Draws a string.
+     *
+     * Characters outside printable ASCII are drawn as spaces.
+     *
+     * @param im Canvas to draw on (CV_8UC3, or CV_8UC1 with the palette index in color[0])
+     * @param text String to draw
+     * @param org Bottom-left corner of the text, as for cv::putText
+     * @param color Text colour
+     * @return Region of im that was drawn over, clipped to im
+     */
+    cv::Rect draw(cv::Mat& im, const char* text, cv::Point org, const cv::Scalar& color);
+
+    /// @brief Draws a string. See draw(cv::Mat&, const char*, cv::Point, const cv::Scalar&).
+    cv::Rect draw(cv::Mat& im, const std::string& text, cv::Point org, const cv::Scalar& color)
+    {
+        return draw(im, text.c_str(), org, color);
+    }
+
+    /// @brief Text height above the baseline in pixels.
+    int get_height() const { return _height; }
+
+    /** @brief Discards all cached string layouts. */
+    void clear_cache() { _layouts.clear(); }
+};